@@ -19,6 +19,7 @@
 #define CPPDB_ATOMIC_COUNT_H
 
 #include <cppdb/defs.h>
+#include <atomic>
 
 
 namespace cppdb {
@@ -26,65 +27,45 @@ namespace cppdb {
 	///
 	/// \brief Atomic counter is a class that allows perform counting in thread safe way.
 	///
-	/// It is mainly used for reference counting. Under Windows it uses Interlocked API, under
-	/// other platforms it used built-in atomic operations or fails back to pthreads locking implementation.
-	///
-	/// Notes: 
-	///
-	/// -  This counter is not safe for use in process shared memory, when pthreads fall-back is used
-	/// -  Under POSIX platform pthread_mutex_t is always present in order to make sure that we can implement
-	///    or remove pthread fall-back at any point not affecting ABI
+	/// It is a thin header-only wrapper of std::atomic<long>, all operations are sequentially consistent.
+	/// ref_counted uses std::atomic directly with weaker ordering.
 	///
 
-	class CPPDB_API atomic_counter {
+	class atomic_counter {
 	public:
 		///
 		/// Create a counter with initial value v
 		///
-    		explicit atomic_counter( long v);
-		~atomic_counter();
+		explicit atomic_counter(long v) : value_(v)
+		{
+		}
 
 		///
 		/// Increment and return the result after increment atomically
 		///
-    		long operator++()
+		long operator++()
 		{
-			return inc();
+			return ++value_;
 		}
 		///
 		/// Decrement and return the result after decrement atomically
 		///
-    		long operator--()
+		long operator--()
 		{
-			return dec();
+			return --value_;
 		}
 		///
 		/// Return current value - atomically
 		///
 		operator long() const 
 		{
-			return get();
+			return value_.load();
 		}
 	private:
-		long inc();
-		long dec();
-		long get() const;
-
 		atomic_counter(atomic_counter const &);
 		atomic_counter & operator=(atomic_counter const &);
 
-		mutable union {
-			int i;
-			unsigned ui;
-			long l;
-			unsigned long ul;
-			long long ll;
-			unsigned long long ull;
-		} value_;
-		// Is actually used for platforms without lock
-		// it would not be used when atomic operations
-		// available
-		void *mutex_;
+		std::atomic<long> value_;
 	};
 
 } // cppdb
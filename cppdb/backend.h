@@ -21,6 +21,7 @@
 #include <ctime>
 #include <string>
 #include <memory>
+#include <memory_resource>
 #include <map>
 #include <vector>
 #include <typeinfo>
@@ -48,6 +49,26 @@ namespace cppdb {
 	///
 	namespace backend {	
 
+		///
+		/// \brief Memory of a connection for the short-lived objects it creates, like query results.
+		///
+		/// Released blocks are kept for reuse, so a steady query loop does not go to the heap. Every block
+		/// allocated from the arena holds a reference to it, so it may outlive its connection.
+		///
+		class CPPDB_API arena : public ref_counted {
+		public:
+			arena();
+			~arena();
+			///
+			/// Get the memory resource of the arena, for example for std::pmr containers of a result.
+			/// It is thread safe.
+			///
+			std::pmr::memory_resource *resource();
+		private:
+			struct data;
+			std::unique_ptr<data> d;
+		};
+
 		///
 		/// \brief This class represents query result.
 		///
@@ -189,6 +210,20 @@ namespace cppdb {
 			///
 			virtual bool fetch(int col,std::tm &v) = 0;
 			///
+			/// Fetch a point in time for column \a col starting from 0 with microsecond precision.
+			/// Returns true if ok, returns false if the column value is NULL and the referenced object should remain unchanged
+			///
+			/// Default implementation fetches the value as text and parses it with parse_timestamp()
+			///
+			virtual bool fetch(int col,sys_microseconds &v);
+			///
+			/// Fetch a decimal number for column \a col starting from 0.
+			/// Returns true if ok, returns false if the column value is NULL and the referenced object should remain unchanged
+			///
+			/// Default implementation fetches the value as text and parses it with parse_decimal()
+			///
+			virtual bool fetch(int col,decimal &v);
+			///
 			/// Check if the column \a col is NULL starting from 0, should throw invalid_column() if the index out of range
 			///
 			virtual bool is_null(int col) = 0;
@@ -207,9 +242,37 @@ namespace cppdb {
 			/// Should be able to work even without calling next() first time.
 			///
 			virtual std::string column_to_name(int) = 0;
+			///
+			/// Return the type of column \a col starting from 0 as declared in the database schema, for example
+			/// "integer" or "varchar(10)". Returns empty string if the type is unknown, for example when
+			/// the column is an expression. Should throw invalid_column() if the index out of range.
+			/// Should be able to work even without calling next() first time.
+			///
+			/// Default implementation throws not_supported_by_backend()
+			///
+			virtual std::string declared_type(int col);
+			///
+			/// Move to the next result set produced by the statement, for example by a stored procedure
+			/// or by several statements executed at once. Returns false if there are no more result sets.
+			///
+			/// Result sets of statements that do not return rows are skipped. After it returns true, cols(),
+			/// column names and types describe the new result set and next() should be called before fetching data.
+			///
+			/// Default implementation throws not_supported_by_backend()
+			///
+			virtual bool next_result();
 
 			result();
 			virtual ~result();
+
+			/// \cond INTERNAL
+			// Results are allocated as new(a) result(...) from the arena \a a of the connection,
+			// a null arena uses the heap
+			static void *operator new(size_t n);
+			static void *operator new(size_t n,arena *a);
+			static void operator delete(void *p);
+			static void operator delete(void *p,arena *a);
+			/// \endcond
 		private:
 			struct data;
 			std::unique_ptr<data> d;
@@ -229,7 +292,11 @@ namespace cppdb {
 
 			///
 			/// Reset the prepared statement to initial state as before the operation. It is
-			/// called by front-end each time before new query() or exec() are called.
+			/// called by front-end each time before new query() or exec() are called and
+			/// each time the statement returns to the statements cache.
+			///
+			/// It should work in place: clear the bound values but keep the allocated buffers,
+			/// so a cached statement can be executed again without memory allocation.
 			///
 			virtual void reset() = 0;
 			///
@@ -274,6 +341,20 @@ namespace cppdb {
 			///
 			virtual void bind(int col,std::tm const &) = 0;
 			///
+			/// Bind a point in time with microsecond precision to column \a col (starting from 1).
+			///
+			/// Default implementation binds the text created by format_timestamp() using bind(int,std::string const &),
+			/// so backends that keep a reference to the bound string must override it.
+			///
+			virtual void bind(int col,sys_microseconds const &v);
+			///
+			/// Bind a decimal number to column \a col (starting from 1).
+			///
+			/// Default implementation binds the text created by format_decimal() using bind(int,std::string const &),
+			/// so backends that keep a reference to the bound string must override it.
+			///
+			virtual void bind(int col,decimal const &v);
+			///
 			/// Bind a BLOB value to column \a col (starting from 1).
 			///
 			/// Should throw invalid_placeholder() if the value of col is out of range. May
@@ -387,6 +468,32 @@ namespace cppdb {
 			/// Execute a statement, MAY throw cppdb_error if the statement returns results.
 			///
 			virtual void exec() = 0;
+			///
+			/// Execute an INSERT statement and return the values of \a columns of the inserted rows,
+			/// like the generated keys, in a single round trip when the engine supports it.
+			///
+			/// Default implementation calls exec() and returns a single row with the value of
+			/// sequence_last() as the only column, it throws not_supported_by_backend() if more than
+			/// one column is requested.
+			///
+			virtual result *exec_returning(std::vector<std::string> const &columns);
+			///
+			/// Start the execution of the statement without waiting for its completion. Returns false if
+			/// the backend does not support asynchronous execution, in such case nothing is executed.
+			///
+			/// Once started, query() or exec() should complete the execution and return its outcome
+			/// without executing the statement once again, waiting for the completion if required.
+			///
+			/// Default implementation returns false.
+			///
+			virtual bool start_async();
+			///
+			/// Advance the asynchronous execution started by start_async(), returns true if it is
+			/// completed or if no execution is in progress. Should never block.
+			///
+			/// Default implementation returns true.
+			///
+			virtual bool poll_async();
 
 			/// \cond INTERNAL 
 			// Caching support
@@ -404,6 +511,23 @@ namespace cppdb {
 			statement();
 			virtual ~statement() ;
 			/// \endcond
+		protected:
+			///
+			/// Get the arena of the connection of the statement for allocating its results,
+			/// returns 0 if the statement is not bound to a connection.
+			///
+			arena *get_arena();
+			///
+			/// Get the query rewritten by the dialect of the connection to return \a columns of the
+			/// inserted rows, see dialect::insert_returning(). Returns an empty string if the dialect can't
+			/// do it. The query is kept, so it is rendered once for the same columns.
+			///
+			std::string const &returning_query(std::vector<std::string> const &columns);
+			///
+			/// Create a result of a single column \a name with \a count rows of consecutive values
+			/// starting from \a first, for the engines that report only the first or the last generated id.
+			///
+			result *generated_keys(std::string const &name,long long first,unsigned long long count);
 		private:
 			struct data;
 			std::unique_ptr<data> d;
@@ -659,6 +783,36 @@ namespace cppdb {
 			{
 				return sequence_last_;
 			}
+			///
+			/// The "insert_returning" mode set by the \@insert_returning option, it overrides the one
+			/// of the dialect, empty if it is not set
+			///
+			std::string const &insert_returning() const;
+			///
+			/// Get driver specific extension interface by its type \a type, returns 0 if the driver
+			/// does not provide such interface. The ownership is not changed.
+			///
+			/// Default implementation returns 0.
+			///
+			virtual void *get_extension(std::type_info const &type);
+			///
+			/// Advance the asynchronous execution of a statement on this connection, returns true if
+			/// no execution is in progress. Should never block.
+			///
+			/// Default implementation returns true.
+			///
+			virtual bool poll_async();
+			///
+			/// Get the socket descriptor that should be waited for readability during the asynchronous
+			/// execution of a statement on this connection, returns -1 if it is not available.
+			///
+			/// Default implementation returns -1.
+			///
+			virtual int async_socket();
+			///
+			/// Get the arena for the short-lived objects created by this connection, it is never null
+			///
+			arena *get_arena();
 
 		private:
 
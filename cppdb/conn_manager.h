@@ -55,13 +55,18 @@ namespace cppdb {
 		///
 		/// Create a new connection using connection string \a cs
 		///
+		/// The connection string is parsed only the first time it is used, the parsed connection_info
+		/// and the pool are found by the hash of \a cs afterwards without a lock, only adding a new
+		/// connection string or collecting unused pools takes the lock.
+		///
 		ref_ptr<backend::connection> open(std::string const &cs);
 		///
 		/// Create a new connection using parsed connection string \a ci
 		///
 		ref_ptr<backend::connection> open(connection_info const &ci);
 		///
-		/// Collect all connections that were not used for long time and close them.
+		/// Collect all connections that were not used for long time and close them,
+		/// the pools that have no more connections are released.
 		///
 		void gc();
 		///
@@ -74,8 +79,6 @@ namespace cppdb {
 		std::unique_ptr<data> d;
 
 		mutex lock_;
-		typedef std::map<std::string,ref_ptr<pool> > connections_type;
-		connections_type connections_;
 	};
 } // cppdb
 
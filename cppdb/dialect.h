@@ -124,6 +124,21 @@ namespace cppdb {
 				return get_keyword("sequence_last", "");
 			}
 			///
+			/// Rewrite the INSERT \a query to return the \a columns of the inserted rows according to the
+			/// "insert_returning" keyword: "returning" appends a RETURNING clause and "output" puts an
+			/// OUTPUT INSERTED clause before VALUES, SELECT or DEFAULT VALUES.
+			///
+			/// Returns an empty string if the dialect can't return the inserted rows.
+			///
+			virtual std::string insert_returning(std::string const &query, std::vector<std::string> const &columns) const;
+			///
+			/// Rewrite the INSERT \a query to return the \a columns of the inserted rows using \a mode,
+			/// one of the values of the "insert_returning" keyword.
+			///
+			/// Returns an empty string for any other mode or if the query can't be rewritten.
+			///
+			static std::string rewrite_returning(std::string const &mode, std::string const &query, std::vector<std::string> const &columns);
+			///
 			/// create table suffix
 			///
 			virtual std::string create_table_suffix() const
@@ -24,6 +24,7 @@
 #include <map>
 #include <string>
 #include <vector>
+#include <memory>
 
 namespace cppdb {
 	namespace backend {
@@ -35,7 +36,9 @@ namespace cppdb {
 	///
 	/// \brief this class is used to handle all drivers, loading them, unloading them etc.
 	///
-	/// All its member functions are thread safe
+	/// All its member functions are thread safe. The installed drivers are kept in an immutable snapshot
+	/// so finding an installed driver does not take a lock, a loadable driver is loaded
+	/// only once even if several threads connect using it for the first time.
 	///
 	class CPPDB_API driver_manager {
 	public:
@@ -46,6 +49,9 @@ namespace cppdb {
 		///
 		/// Install new driver \a drv named \a name to the manager.
 		///
+		/// A driver replaced with \a force is released before the call returns, once the lookups
+		/// in progress that may still use it are done.
+		///
 		ref_ptr<backend::driver> install_driver(std::string const &name,ref_ptr<backend::driver> drv, bool force=false);
 		///
 		/// Unload all drivers that have no more open connections.
@@ -88,10 +94,10 @@ namespace cppdb {
 		
 		ref_ptr<backend::driver> load_driver(connection_info const &ci, std::string const &driver_name=std::string());
 
-		typedef std::map<std::string,ref_ptr<backend::driver> > drivers_type;
+		struct data;
+		std::unique_ptr<data> d;
 		std::vector<std::string> search_paths_;
 		bool no_default_directory_; 
-		drivers_type drivers_;
 		mutex lock_;
 	};
 }
@@ -20,6 +20,7 @@
 #include <cppdb/defs.h>
 #include <cppdb/errors.h>
 #include <cppdb/ref_ptr.h>
+#include <cppdb/utils.h>
 
 // Borland errors about unknown pool-type without this include.
 #ifdef __BORLANDC__
@@ -30,6 +31,7 @@
 #include <ctime>
 #include <string>
 #include <memory>
+#include <future>
 #include <typeinfo>
 
 ///
@@ -239,6 +241,14 @@ namespace cppdb {
 		/// - You must not call fetch() functions if next() returned false, it would cause empty_row_access exception.
 		///
 		bool next();
+		///
+		/// Move to the next result set, for example when a stored procedure returns several result sets or
+		/// several statements were executed at once. Returns false if there are no more result sets.
+		///
+		/// After it returns true, the result behaves as a newly created one: call next() before fetching data.
+		/// Throws not_supported_by_backend if the backend does not support multiple result sets.
+		///
+		bool next_result();
 		
 		///
 		/// Convert column name \a n to its index, throws invalid_column if the name is not valid.
@@ -253,6 +263,12 @@ namespace cppdb {
 		/// Convert column index to column name, throws invalid_column if col is not in range 0<= col < cols()
 		///
 		std::string name(int col);
+		///
+		/// Get the type of column \a col as declared in the database schema, returns empty string if it is not
+		/// known. Throws invalid_column if col is not in range 0<= col < cols(), throws not_supported_by_backend
+		/// if the backend does not provide this information.
+		///
+		std::string declared_type(int col);
 
 		///
 		/// Return true if the column number \a col (starting from 0) has NULL value
@@ -347,6 +363,14 @@ namespace cppdb {
 		///
 		bool fetch(int col,std::tm &v);
 		///
+		/// \copydoc fetch(int,short&)
+		///
+		bool fetch(int col,sys_microseconds &v);
+		///
+		/// \copydoc fetch(int,short&)
+		///
+		bool fetch(int col,decimal &v);
+		///
 		/// Fetch a binary large object value from column \a col (starting from 0) into a stream \a v. Returns false
 		/// if the value in NULL and \a v is not updated, otherwise returns true.
 		///
@@ -417,6 +441,14 @@ namespace cppdb {
 		///
 		bool fetch(std::string const &n,std::tm &v);
 		///
+		/// \copydoc fetch(std::string const &,short&)
+		///
+		bool fetch(std::string const &n,sys_microseconds &v);
+		///
+		/// \copydoc fetch(std::string const &,short&)
+		///
+		bool fetch(std::string const &n,decimal &v);
+		///
 		/// Fetch a binary large object value from column named \a name into a stream \a v. Returns false
 		/// if the value in NULL and \a v is not updated, otherwise returns true.
 		///
@@ -473,6 +505,10 @@ namespace cppdb {
 		bool fetch(std::string &v);
 		/// \copydoc fetch(short&)
 		bool fetch(std::tm &v);
+		/// \copydoc fetch(short&)
+		bool fetch(sys_microseconds &v);
+		/// \copydoc fetch(short&)
+		bool fetch(decimal &v);
 		///
 		/// Fetch a blob value from the next column in the row starting from the first one into stream \a v. Returns false
 		/// if the value in NULL and \a v is not updated, otherwise returns true.
@@ -714,6 +750,10 @@ namespace cppdb {
 		statement &bind(char const *b,char const *e);
 		/// \copydoc bind(int)
 		statement &bind(std::tm const &v);
+		/// \copydoc bind(int)
+		statement &bind(sys_microseconds const &v);
+		/// \copydoc bind(int)
+		statement &bind(decimal const &v);
 		///
 		/// Bind a BLOB value \a v to the next placeholder marked with '?' marker in the query.
 		///
@@ -806,6 +846,10 @@ namespace cppdb {
 		void bind(int col,char const *b,char const *e);
 		/// \copydoc bind(int,int)
 		void bind(int col,std::tm const &v);
+		/// \copydoc bind(int,int)
+		void bind(int col,sys_microseconds const &v);
+		/// \copydoc bind(int,int)
+		void bind(int col,decimal const &v);
 		///
 		/// Bind a BLOB value \a v to the placeholder number \a col (starting from 1) marked with '?' marker in the query.
 		///
@@ -881,6 +925,45 @@ namespace cppdb {
 		/// however the behavior may vary between backends that may ignore this error.
 		///
 		void exec();
+		///
+		/// Execute an INSERT statement and return the values of \a columns of the inserted rows,
+		/// for example the generated keys: exec_returning({"id"}). All the rows of a multiple row insert
+		/// are returned.
+		///
+		/// It uses RETURNING or OUTPUT INSERTED when the dialect supports it, so no additional query is
+		/// sent. Otherwise the value of sequence_last() is returned for a single inserted row, and engines
+		/// like MySQL throw not_supported_by_backend after executing an insert that did not insert exactly
+		/// one row, as the ids of the other rows are not reported.
+		///
+		result exec_returning(std::vector<std::string> const &columns);
+
+		///
+		/// Start the execution of the statement without waiting for its completion, returns false if the backend
+		/// does not support asynchronous execution, in such case the statement is not executed.
+		///
+		/// Use ready() or session::poll() to check whether the execution is completed and then call query() or exec()
+		/// to get its outcome. They would wait for the completion if the execution is still in progress.
+		///
+		bool start();
+		///
+		/// Returns true if the execution started by start() is completed or if no execution is in progress.
+		///
+		bool ready();
+
+		///
+		/// Execute the query asynchronously and return a future of its result.
+		///
+		/// If the backend supports asynchronous execution the statement is started with start() and the query is
+		/// completed by std::future::get(), use ready() or session::poll() to find when it would not block.
+		/// Otherwise the query is executed by a shared pool of worker threads.
+		///
+		/// The session and the statement must not be used until the future is ready.
+		///
+		std::future<result> async_query();
+		///
+		/// Execute the statement asynchronously, same as async_query() but for exec()
+		///
+		std::future<void> async_exec();
 
 		///
 		/// Same as bind(v);
@@ -897,6 +980,14 @@ namespace cppdb {
 		///
 		/// Same as bind(v);
 		///
+		statement &operator<<(sys_microseconds const &v);
+		///
+		/// Same as bind(v);
+		///
+		statement &operator<<(decimal const &v);
+		///
+		/// Same as bind(v);
+		///
 		statement &operator<<(std::istream &v);
 		///
 		/// Apply manipulator on the statement, same as manipulator(*this).
@@ -1258,6 +1349,32 @@ namespace cppdb {
 			reset_specific(typeid(T),p);
 		}
 
+		///
+		/// Get driver specific extension interface by its type \a t, returns 0 if the driver does not provide it
+		///
+		void *get_extension(std::type_info const &t);
+		///
+		/// Get driver specific extension interface of type \a T, returns 0 if the driver does not provide it
+		///
+		/// For example cppdb::sqlite3_backend::extension
+		///
+		template<typename T>
+		T *get_extension()
+		{
+			return static_cast<T*>(get_extension(typeid(T)));
+		}
+
+		///
+		/// Advance the asynchronous execution of a statement started with statement::start() on this session,
+		/// returns true if no execution is in progress. It never blocks, so it can be called from an event loop.
+		///
+		bool poll();
+		///
+		/// Get the socket descriptor an event loop should wait on for readability while a statement started with
+		/// statement::start() is executed, returns -1 if the backend does not provide it.
+		///
+		int async_socket();
+
 	private:
 		struct data;
 		std::unique_ptr<data> d;
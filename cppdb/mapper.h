@@ -0,0 +1,328 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//  Copyright (C) 2020  Alex Bodnaru <alexbodn@gmail.com>
+//
+//  Distributed under:
+//
+//                   the Boost Software License, Version 1.0.
+//              (See accompanying file LICENSE_1_0.txt or copy at
+//                     http://www.boost.org/LICENSE_1_0.txt)
+//
+//  or (at your opinion) under:
+//
+//                               The MIT License
+//                 (See accompanying file MIT.txt or a copy at
+//              http://www.opensource.org/licenses/mit-license.php)
+//
+///////////////////////////////////////////////////////////////////////////////
+#ifndef CPPDB_MAPPER_H
+#define CPPDB_MAPPER_H
+
+#include <cppdb/frontend.h>
+#include <cppdb/schema.h>
+
+#include <tuple>
+#include <vector>
+#include <string>
+#include <utility>
+#include <algorithm>
+
+namespace cppdb {
+namespace schema {
+
+	///
+	/// \brief The SQL statements of an entity, rendered once for a fixed order of its columns.
+	///
+	/// All the statements list the columns in the given order, so the values can be bound in that
+	/// order, skipping the primary key or the generated columns where they do not appear.
+	///
+	class entity_sql {
+	public:
+		///
+		/// Render the statements of \a table with \a columns in this order, \a primary are the columns
+		/// of the primary key and \a generated the columns filled by the database on insert,
+		/// like an auto increment key.
+		///
+		entity_sql(
+			std::string const &table,
+			std::vector<std::string> const &columns,
+			std::vector<std::string> const &primary,
+			std::vector<std::string> const &generated = std::vector<std::string>())
+		{
+			init(table, columns, primary, generated);
+		}
+		///
+		/// Render the statements of a finalized entity \a e, with \a columns in this order.
+		///
+		/// Throws cppdb_error if a column does not exist in the entity or it has no primary key.
+		///
+		entity_sql(entity const &e, std::vector<std::string> const &columns)
+		{
+			std::vector<std::string> generated;
+			for (auto const &name : columns) {
+				auto p = e.columns().find(name);
+				if (p == e.columns().end()) {
+					throw cppdb_error("cppdb::schema: column " + name + " not in entity " + e.name());
+				}
+				if (p->second->is_auto_increment()) {
+					generated.push_back(name);
+				}
+			}
+			init(e.table_name().empty() ? e.name() : e.table_name(), columns, e.primary_columns(), generated);
+		}
+
+		std::string const &insert_sql() const { return insert_; }
+		std::string const &update_sql() const { return update_; }
+		std::string const &select_sql() const { return select_; }
+		std::string const &delete_sql() const { return delete_; }
+		///
+		/// The generated columns, in the order of the columns
+		///
+		std::vector<std::string> const &generated_columns() const { return generated_; }
+		///
+		/// Whether the column at \a index is a part of the primary key
+		///
+		bool is_primary(size_t index) const { return flags_[index] & primary_flag; }
+		///
+		/// Whether the column at \a index is generated by the database on insert
+		///
+		bool is_generated(size_t index) const { return flags_[index] & generated_flag; }
+
+	private:
+		static const char primary_flag = 1;
+		static const char generated_flag = 2;
+
+		static bool contains(std::vector<std::string> const &v, std::string const &name)
+		{
+			return std::find(v.begin(), v.end(), name) != v.end();
+		}
+		void init(
+			std::string const &table,
+			std::vector<std::string> const &columns,
+			std::vector<std::string> const &primary,
+			std::vector<std::string> const &generated)
+		{
+			if (primary.empty()) {
+				throw cppdb_error("cppdb::schema: no primary key for " + table);
+			}
+			std::string insert_columns, insert_values, all_columns, set_columns, where;
+			for (auto const &name : primary) {
+				if (!contains(columns, name)) {
+					throw cppdb_error("cppdb::schema: primary key column " + name + " is not mapped in " + table);
+				}
+			}
+			for (auto const &name : columns) {
+				char flags = 0;
+				if (contains(primary, name)) {
+					flags |= primary_flag;
+				}
+				if (contains(generated, name)) {
+					flags |= generated_flag;
+					generated_.push_back(name);
+				}
+				flags_.push_back(flags);
+
+				all_columns += (all_columns.empty() ? "" : ", ") + name;
+				if (!(flags & generated_flag)) {
+					insert_columns += (insert_columns.empty() ? "" : ", ") + name;
+					insert_values += insert_values.empty() ? "?" : ", ?";
+				}
+				if (!(flags & primary_flag)) {
+					set_columns += (set_columns.empty() ? "" : ", ") + name + " = ?";
+				}
+				else {
+					where += (where.empty() ? "" : " AND ") + name + " = ?";
+				}
+			}
+			if (insert_columns.empty()) {
+				insert_ = "INSERT INTO " + table + " DEFAULT VALUES";
+			}
+			else {
+				insert_ = "INSERT INTO " + table + "(" + insert_columns + ") VALUES(" + insert_values + ")";
+			}
+			// an entity made of its key only has nothing to update
+			if (!set_columns.empty()) {
+				update_ = "UPDATE " + table + " SET " + set_columns + " WHERE " + where;
+			}
+			select_ = "SELECT " + all_columns + " FROM " + table + " WHERE " + where;
+			delete_ = "DELETE FROM " + table + " WHERE " + where;
+		}
+
+		std::string insert_;
+		std::string update_;
+		std::string select_;
+		std::string delete_;
+		std::vector<std::string> generated_;
+		std::vector<char> flags_;
+	};
+
+	///
+	/// \brief A column \a name of an entity mapped to the \a member of the struct T
+	///
+	template<typename T, typename M>
+	struct field {
+		char const *name;
+		M T::*member;
+	};
+
+	///
+	/// Create a field of the compile time field list of mapping<T>
+	///
+	template<typename T, typename M>
+	constexpr field<T, M> make_field(char const *name, M T::*member)
+	{
+		return field<T, M>{name, member};
+	}
+
+	///
+	/// \brief The compile time field list of the struct T, should be specialized for every mapped struct:
+	///
+	/// \code
+	///  template<>
+	///  struct mapping<person> {
+	///      static constexpr auto fields()
+	///      {
+	///          return std::make_tuple(make_field("id", &person::id), make_field("name", &person::name));
+	///      }
+	///  };
+	/// \endcode
+	///
+	template<typename T>
+	struct mapping;
+
+	///
+	/// \brief Load and save the objects of the struct T in the table of an entity.
+	///
+	/// The SQL is rendered once when the mapper is created and the statements are fetched from the
+	/// statements cache of the session, so an operation is a cached prepared statement and the binds
+	/// of the fields in the order of mapping<T>::fields(), without run time lookup of the columns.
+	///
+	template<typename T>
+	class mapper {
+		typedef decltype(mapping<T>::fields()) fields_type;
+		typedef std::make_index_sequence<std::tuple_size<fields_type>::value> indexes;
+	public:
+		///
+		/// Map T to the finalized entity \a e, the auto increment columns are read back on insert
+		///
+		mapper(entity const &e) :
+			sql_(e, field_names(indexes()))
+		{
+		}
+		///
+		/// Map T to \a table with the primary key \a primary and the \a generated columns
+		/// read back on insert
+		///
+		mapper(
+			std::string const &table,
+			std::vector<std::string> const &primary,
+			std::vector<std::string> const &generated = std::vector<std::string>()) :
+			sql_(table, field_names(indexes()), primary, generated)
+		{
+		}
+		///
+		/// Get the SQL statements of the mapper
+		///
+		entity_sql const &sql() const
+		{
+			return sql_;
+		}
+		///
+		/// Insert \a obj, the generated columns are fetched into it by statement::exec_returning()
+		///
+		void insert(session &s, T &obj) const
+		{
+			statement st = s.prepare(sql_.insert_sql());
+			bind_insert(st, obj, indexes());
+			if (sql_.generated_columns().empty()) {
+				st.exec();
+				return;
+			}
+			result r = st.exec_returning(sql_.generated_columns());
+			if (!r.next()) {
+				throw cppdb_error("cppdb::schema: no generated columns returned by insert");
+			}
+			fetch_generated(r, obj, indexes());
+		}
+		///
+		/// Update the row of \a obj by its primary key
+		///
+		void update(session &s, T const &obj) const
+		{
+			if (sql_.update_sql().empty()) {
+				return;
+			}
+			statement st = s.prepare(sql_.update_sql());
+			bind_values(st, obj, indexes());
+			bind_key(st, obj, indexes());
+			st.exec();
+		}
+		///
+		/// Load \a obj by the primary key that is set in it, returns false if there is no such row
+		///
+		bool load(session &s, T &obj) const
+		{
+			statement st = s.prepare(sql_.select_sql());
+			bind_key(st, obj, indexes());
+			result r = st.row();
+			if (r.empty()) {
+				return false;
+			}
+			fetch_all(r, obj, indexes());
+			return true;
+		}
+		///
+		/// Delete the row of \a obj by its primary key
+		///
+		void remove(session &s, T const &obj) const
+		{
+			statement st = s.prepare(sql_.delete_sql());
+			bind_key(st, obj, indexes());
+			st.exec();
+		}
+
+	private:
+		template<size_t... I>
+		static std::vector<std::string> field_names(std::index_sequence<I...>)
+		{
+			constexpr fields_type f = mapping<T>::fields();
+			return std::vector<std::string>{std::get<I>(f).name...};
+		}
+		template<size_t... I>
+		void bind_insert(statement &st, T const &obj, std::index_sequence<I...>) const
+		{
+			constexpr fields_type f = mapping<T>::fields();
+			((sql_.is_generated(I) ? void() : void(st << obj.*std::get<I>(f).member)), ...);
+		}
+		template<size_t... I>
+		void bind_values(statement &st, T const &obj, std::index_sequence<I...>) const
+		{
+			constexpr fields_type f = mapping<T>::fields();
+			((sql_.is_primary(I) ? void() : void(st << obj.*std::get<I>(f).member)), ...);
+		}
+		template<size_t... I>
+		void bind_key(statement &st, T const &obj, std::index_sequence<I...>) const
+		{
+			constexpr fields_type f = mapping<T>::fields();
+			((sql_.is_primary(I) ? void(st << obj.*std::get<I>(f).member) : void()), ...);
+		}
+		template<size_t... I>
+		void fetch_generated(result &r, T &obj, std::index_sequence<I...>) const
+		{
+			constexpr fields_type f = mapping<T>::fields();
+			((sql_.is_generated(I) ? void(r >> obj.*std::get<I>(f).member) : void()), ...);
+		}
+		template<size_t... I>
+		void fetch_all(result &r, T &obj, std::index_sequence<I...>) const
+		{
+			constexpr fields_type f = mapping<T>::fields();
+			(void(r >> obj.*std::get<I>(f).member), ...);
+		}
+
+		entity_sql sql_;
+	};
+
+} // schema
+} // cppdb
+
+#endif // CPPDB_MAPPER_H
@@ -19,27 +19,34 @@
 #define CPPDB_MUTEX_H
 
 #include <cppdb/defs.h>
+#include <mutex>
 
 namespace cppdb {
 
 	///
 	/// \brief mutex class, used internally
 	///
-	class CPPDB_API mutex {
+	class mutex {
 		mutex(mutex const &);
 		void operator=(mutex const  &);
 	public:
 		class guard;
 		/// Create mutex
-		mutex();
+		mutex() {}
 		/// Destroy mutex
-		~mutex();
+		~mutex() {}
 		/// Lock mutex
-		void lock();
+		void lock()
+		{
+			m_.lock();
+		}
 		/// Unlock mutex
-		void unlock();
+		void unlock()
+		{
+			m_.unlock();
+		}
 	private:
-		void *mutex_impl_;
+		std::mutex m_;
 	};
 
 	///
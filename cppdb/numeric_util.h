@@ -22,54 +22,218 @@
 #include <string>
 #include <sstream>
 #include <limits>
+#include <cmath>
 #include <iomanip>
+#include <type_traits>
+#if __cplusplus >= 201703L && defined(__has_include)
+#  if __has_include(<charconv>)
+#    include <charconv>
+#  endif
+#endif
 
 namespace cppdb {
 
+	/// \cond INTERNAL
+	namespace details {
+		template<typename T>
+		bool is_negative(T v,std::true_type /*signed*/)
+		{
+			return v < 0;
+		}
+		template<typename T>
+		bool is_negative(T /*v*/,std::false_type /*unsigned*/)
+		{
+			return false;
+		}
+		template<typename T,typename S>
+		T numeric_cast(S v,std::true_type /*floating source*/)
+		{
+			if(std::numeric_limits<T>::is_integer) {
+				// max() + 1 is a power of 2 that is exact in S, unlike max() that may be rounded up,
+				// and the negated form rejects NaN
+				S const limit = std::ldexp(S(1),std::numeric_limits<T>::digits);
+				if(!(v >= static_cast<S>(std::numeric_limits<T>::min()) && v < limit))
+					throw bad_value_cast();
+			}
+			return static_cast<T>(v);
+		}
+		template<typename T,typename S>
+		T numeric_cast(S v,std::false_type /*integer source*/)
+		{
+			if(!std::numeric_limits<T>::is_integer)
+				return static_cast<T>(v);
+			if(is_negative(v,std::integral_constant<bool,std::numeric_limits<S>::is_signed>())) {
+				if(!std::numeric_limits<T>::is_signed)
+					throw bad_value_cast();
+				if(static_cast<long long>(v) < static_cast<long long>(std::numeric_limits<T>::min()))
+					throw bad_value_cast();
+			}
+			else {
+				if(static_cast<unsigned long long>(v) > static_cast<unsigned long long>(std::numeric_limits<T>::max()))
+					throw bad_value_cast();
+			}
+			return static_cast<T>(v);
+		}
+	} // details
+	/// \endcond
+
 	///
-	/// Small utility functions for backends, accepts - source string and stringstream with imbued std::locale
-	/// it tries to case the value to T in best possible way.
-	///
-	/// For floating point string it casts it to the nearest ineger
+	/// Small utility function for backends that fetch numbers in native binary form, converts the value \a v to
+	/// type T, throws bad_value_cast() if the value is out of range of T, same as parse_number does.
 	///
-	template<typename T>
-	T parse_number(std::string const &s,std::istringstream &ss)
+	template<typename T,typename S>
+	T numeric_cast(S v)
 	{
-		ss.clear();
-		ss.str(s);
-		if(s.find_first_of(".eEdD")!=std::string::npos) {
-			long double v;
+		return details::numeric_cast<T>(v,std::integral_constant<bool,!std::numeric_limits<S>::is_integer>());
+	}
+
+	/// \cond INTERNAL
+	namespace details {
+		inline bool is_space(char c)
+		{
+			return c==' ' || ('\t' <= c && c <= '\r');
+		}
+		template<typename R>
+		R parse_number(char const *b,char const *e)
+		{
+			R v;
+#ifdef __cpp_lib_to_chars
+			std::from_chars_result r = std::from_chars(b,e,v);
+			if(r.ec != std::errc() || r.ptr != e)
+				throw bad_value_cast();
+#else
+			std::istringstream ss(std::string(b,e));
+			ss.imbue(std::locale::classic());
 			ss >> v;
-			if(ss.fail() || !std::ws(ss).eof())
+			if(ss.fail() || !ss.eof())
 				throw bad_value_cast();
-#ifdef __BORLANDC__
-#pragma warn -8008 // condition always true/false
-#pragma warn -8066 // unreachable code
 #endif
-			if(std::numeric_limits<T>::is_integer) {
-				if(v > std::numeric_limits<T>::max() || v < std::numeric_limits<T>::min())
+			return v;
+		}
+		template<typename T>
+		T parse_number(char const *b,char const *e,std::true_type /*integer*/)
+		{
+			// fast path: up to 18 digits never overflow
+			if(e - b <= std::numeric_limits<long long>::digits10) {
+				unsigned long long u = 0;
+				char const *p = b;
+				while(p != e && '0' <= *p && *p <= '9')
+					u = u * 10 + (*p++ - '0');
+				if(p == e)
+					return cppdb::numeric_cast<T>(u);
+			}
+			for(char const *p = b;p != e;p++) {
+				switch(*p) {
+				case '.': case 'e': case 'E': case 'd': case 'D':
+					return cppdb::numeric_cast<T>(parse_number<long double>(b,e));
+				}
+			}
+			if(!std::numeric_limits<T>::is_signed && *b == '-') {
+				// "-0" is the only valid negative value
+				if(parse_number<T>(b + 1,e) != 0)
 					throw bad_value_cast();
+				return 0;
 			}
-#ifdef __BORLANDC__
-#pragma warn .8008
-#pragma warn .8066
-#endif
-			return static_cast<T>(v);
+			return parse_number<T>(b,e);
 		}
-		T v;
-		ss >> v;
-		if(ss.fail() || !std::ws(ss).eof()) 
-			throw bad_value_cast();
-		if(	std::numeric_limits<T>::is_integer 
-			&& !std::numeric_limits<T>::is_signed 
-			&& s.find('-') != std::string::npos 
-			&& v!=0) 
+		template<typename T>
+		T parse_number(char const *b,char const *e,std::false_type /*floating*/)
 		{
-			throw bad_value_cast();
+			return parse_number<T>(b,e);
 		}
-		return v;
+	} // details
+	/// \endcond
+
+	///
+	/// Small utility function for backends, parses the text [b,e) as a number of type T, without using locale
+	/// and without memory allocation.
+	///
+	/// Surrounding white space is ignored. A text with a fractional part or an exponent is converted to the
+	/// integer T by truncation. Throws bad_value_cast() if the text is not a number or is out of range of T.
+	///
+	template<typename T>
+	T parse_number(char const *b,char const *e)
+	{
+		while(b != e && details::is_space(*b))
+			b++;
+		while(e != b && details::is_space(e[-1]))
+			e--;
+		if(b != e && *b == '+' && e - b > 1 && b[1] != '-')
+			b++;
+		if(b == e)
+			throw bad_value_cast();
+		return details::parse_number<T>(b,e,std::integral_constant<bool,std::numeric_limits<T>::is_integer>());
 	}
 
+	///
+	/// Small utility functions for backends, accepts - source string and stringstream with imbued std::locale
+	/// it tries to case the value to T in best possible way.
+	///
+	/// For floating point string it casts it to the nearest ineger
+	///
+	/// The stream is not used any more, use parse_number(char const *,char const *) instead.
+	///
+	template<typename T>
+	T parse_number(std::string const &s,std::istringstream &/*ss*/)
+	{
+		return parse_number<T>(s.c_str(),s.c_str() + s.size());
+	}
+
+	///
+	/// The size of the buffer that is enough for format_number()
+	///
+	static const int number_buffer_size = 64;
+
+	/// \cond INTERNAL
+	namespace details {
+		template<typename T>
+		char *format_number(char *buf,T v,std::true_type /*integer*/)
+		{
+			char tmp[std::numeric_limits<unsigned long long>::digits10 + 1];
+			char *end = tmp + sizeof(tmp);
+			char *p = end;
+			unsigned long long u = static_cast<unsigned long long>(v);
+			if(is_negative(v,std::integral_constant<bool,std::numeric_limits<T>::is_signed>())) {
+				*buf++ = '-';
+				u = 0ULL - u;
+			}
+			do {
+				*--p = static_cast<char>('0' + u % 10);
+				u /= 10;
+			} while(u);
+			while(p != end)
+				*buf++ = *p++;
+			return buf;
+		}
+		template<typename T>
+		char *format_number(char *buf,T v,std::false_type /*floating*/)
+		{
+			int const precision = std::numeric_limits<T>::digits10+1;
+#ifdef __cpp_lib_to_chars
+			return std::to_chars(buf,buf + number_buffer_size,v,std::chars_format::general,precision).ptr;
+#else
+			std::ostringstream ss;
+			ss.imbue(std::locale::classic());
+			ss << std::setprecision(precision) << v;
+			std::string tmp = ss.str();
+			return tmp.copy(buf,number_buffer_size) + buf;
+#endif
+		}
+	} // details
+	/// \endcond
+
+	///
+	/// Small utility function for backends that format numbers without iostreams, writes the value \a v to
+	/// \a buf that should be at least number_buffer_size long and returns the end of the written text.
+	///
+	/// The output is locale independent, floating point values are written with the same precision that
+	/// is used with std::ostream and std::setprecision(std::numeric_limits<T>::digits10+1).
+	///
+	template<typename T>
+	char *format_number(char *buf,T v)
+	{
+		return details::format_number(buf,v,std::integral_constant<bool,std::numeric_limits<T>::is_integer>());
+	}
 
 }
 #endif
@@ -18,7 +18,7 @@
 #ifndef CPPDB_REF_PTR_H
 #define CPPDB_REF_PTR_H
 #include <cppdb/errors.h>
-#include <cppdb/atomic_counter.h>
+#include <atomic>
 
 namespace cppdb {
 	///
@@ -130,6 +130,9 @@ namespace cppdb {
 	///
 	/// \brief This is a class that implements reference counting and designed to be used with ref_ptr
 	///
+	/// The count is atomic: adding a reference is relaxed as it is always made from an existing one,
+	/// removing it has acquire-release semantics so the object is destroyed after all its uses.
+	///
 	class ref_counted {
 	public:
 		///
@@ -148,6 +151,61 @@ namespace cppdb {
 		/// Increase reference count
 		///
 		long add_ref()
+		{
+			return count_.fetch_add(1,std::memory_order_relaxed) + 1;
+		}
+		///
+		/// Get reference count
+		///
+		long use_count() const
+		{
+			return count_.load(std::memory_order_acquire);
+		}
+		///
+		/// Decrease reference count
+		///
+		long del_ref()
+		{
+			return count_.fetch_sub(1,std::memory_order_acq_rel) - 1;
+		}
+		///
+		/// Delete the object
+		///
+		static void dispose(ref_counted *p)
+		{
+			delete p;
+		}
+	private:
+		ref_counted(ref_counted const &);
+		void operator=(ref_counted const &);
+
+		std::atomic<long> count_;
+	};
+
+	///
+	/// \brief Reference counting for ref_ptr of objects that are used by a single thread at a time
+	///
+	/// The same as ref_counted but the count is a plain integer, so the object and all the ref_ptr pointing
+	/// to it may be passed between threads only with an external synchronization.
+	///
+	class local_ref_counted {
+	public:
+		///
+		/// Create an object with 0 reference count
+		///
+		local_ref_counted() : count_(0) 
+		{
+		}
+		///
+		/// Virtual destructor - for convenience 
+		///
+		virtual ~local_ref_counted()
+		{
+		}
+		///
+		/// Increase reference count
+		///
+		long add_ref()
 		{
 			return ++count_;
 		}
@@ -156,8 +214,7 @@ namespace cppdb {
 		///
 		long use_count() const
 		{
-			long val = count_;
-			return val;
+			return count_;
 		}
 		///
 		/// Decrease reference count
@@ -169,12 +226,15 @@ namespace cppdb {
 		///
 		/// Delete the object
 		///
-		static void dispose(ref_counted *p)
+		static void dispose(local_ref_counted *p)
 		{
 			delete p;
 		}
 	private:
-		atomic_counter count_;
+		local_ref_counted(local_ref_counted const &);
+		void operator=(local_ref_counted const &);
+
+		long count_;
 	};
 } //cppdb
 
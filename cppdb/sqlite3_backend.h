@@ -0,0 +1,511 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//  Copyright (C) 2010-2011  Artyom Beilis (Tonkikh) <artyomtnk@yahoo.com>
+//
+//  Distributed under:
+//
+//                   the Boost Software License, Version 1.0.
+//              (See accompanying file LICENSE_1_0.txt or copy at
+//                     http://www.boost.org/LICENSE_1_0.txt)
+//
+//  or (at your opinion) under:
+//
+//                               The MIT License
+//                 (See accompanying file MIT.txt or a copy at
+//              http://www.opensource.org/licenses/mit-license.php)
+//
+///////////////////////////////////////////////////////////////////////////////
+#ifndef CPPDB_SQLITE3_BACKEND_H
+#define CPPDB_SQLITE3_BACKEND_H
+
+#include <cppdb/errors.h>
+#include <cppdb/ref_ptr.h>
+#include <cppdb/frontend.h>
+#include <string>
+#include <limits>
+#include <tuple>
+#include <type_traits>
+#include <string.h>
+
+namespace cppdb {
+	///
+	/// \brief SQLite3 specific extensions of the sqlite3 driver.
+	///
+	/// None of these classes require sqlite3.h, they are reached from cppdb::session
+	/// using session::get_extension<cppdb::sqlite3_backend::extension>() and implemented
+	/// by the driver itself, so they work with the driver loaded as a shared object.
+	///
+	namespace sqlite3_backend {
+
+		///
+		/// \brief Arguments passed by SQLite to user defined function, column index starts from 0
+		///
+		class function_arguments {
+		public:
+			///
+			/// Number of arguments
+			///
+			virtual int size() const = 0;
+			///
+			/// Check if the argument \a i is NULL
+			///
+			virtual bool is_null(int i) const = 0;
+			///
+			/// Get argument \a i as 64 bit integer
+			///
+			virtual long long get_int64(int i) const = 0;
+			///
+			/// Get argument \a i as floating point value
+			///
+			virtual double get_double(int i) const = 0;
+			///
+			/// Get argument \a i as text, the pointer is valid until the function returns
+			///
+			virtual char const *get_text(int i,size_t &length) const = 0;
+		protected:
+			~function_arguments() {}
+		};
+
+		///
+		/// \brief The value returned from user defined function to SQLite
+		///
+		class function_result {
+		public:
+			///
+			/// Return NULL
+			///
+			virtual void set_null() = 0;
+			///
+			/// Return integer value
+			///
+			virtual void set(long long v) = 0;
+			///
+			/// Return floating point value
+			///
+			virtual void set(double v) = 0;
+			///
+			/// Return text value in range [b,e), the text is copied
+			///
+			virtual void set(char const *b,char const *e) = 0;
+		protected:
+			~function_result() {}
+		};
+
+		///
+		/// \brief Type erased scalar function, see create_function()
+		///
+		class scalar_function : public ref_counted {
+		public:
+			///
+			/// Called for each row, should set the value to \a r. Exceptions are reported to SQLite
+			/// as the function error.
+			///
+			virtual void call(function_result &r,function_arguments &args) = 0;
+		};
+
+		///
+		/// \brief Type erased state of aggregate or window function for a single group
+		///
+		class aggregate_state {
+		public:
+			virtual ~aggregate_state() {}
+			///
+			/// Add a row to the group
+			///
+			virtual void step(function_arguments &args) = 0;
+			///
+			/// Remove a row from the window, called for window functions only
+			///
+			virtual void inverse(function_arguments &args) = 0;
+			///
+			/// Set the current value of the aggregate to \a r
+			///
+			virtual void value(function_result &r) = 0;
+		};
+
+		///
+		/// \brief Type erased aggregate or window function, creates new state for each group
+		///
+		class aggregate_function : public ref_counted {
+		public:
+			///
+			/// Create new empty state, should never return 0
+			///
+			virtual aggregate_state *create() = 0;
+		};
+
+		///
+		/// \brief Progress notification of the online backup, see backup()
+		///
+		class backup_progress {
+		public:
+			///
+			/// Called after each backup step with the number of pages that remain to copy and the
+			/// total number of pages in the source database. Return false to abort the backup.
+			///
+			virtual bool step(int remaining,int total) = 0;
+		protected:
+			~backup_progress() {}
+		};
+
+		///
+		/// \brief Extension interface of sqlite3 connection
+		///
+		/// Get it using session::get_extension<cppdb::sqlite3_backend::extension>(), returns 0 if the
+		/// session does not use sqlite3 driver.
+		///
+		/// The functions remain registered for the lifetime of the connection, including when the
+		/// connection returns to the pool, so it is natural to register them using session::once()
+		///
+		class extension {
+		public:
+			///
+			/// Register a scalar function \a name that receives \a args arguments (-1 for any number). If
+			/// \a deterministic is true SQLite may factor calls out of the inner loops and use the
+			/// function in indexes.
+			///
+			virtual void create_function(std::string const &name,int args,ref_ptr<scalar_function> f,bool deterministic) = 0;
+			///
+			/// Register an aggregate function \a name that receives \a args arguments.
+			///
+			virtual void create_aggregate(std::string const &name,int args,ref_ptr<aggregate_function> f,bool deterministic) = 0;
+			///
+			/// Register an aggregate window function \a name that receives \a args arguments, it may
+			/// be used as both ordinary aggregate and with OVER clause.
+			///
+			/// Throws not_supported_by_backend if SQLite version is older then 3.25
+			///
+			virtual void create_window_function(std::string const &name,int args,ref_ptr<aggregate_function> f,bool deterministic) = 0;
+			///
+			/// Unregister the function \a name with \a args arguments
+			///
+			virtual void remove_function(std::string const &name,int args) = 0;
+			///
+			/// Copy the main database of this connection to the main database of \a target using
+			/// SQLite online backup API, the previous content of \a target is replaced.
+			///
+			/// The copy is done in steps of \a pages_per_step pages (all at once if it is not positive),
+			/// the source is locked only during a step, so writers can proceed between steps, waiting
+			/// \a sleep_ms milliseconds between the steps gives them a chance to do so. If the source is
+			/// modified by other connection during the backup, the backup restarts automatically.
+			///
+			/// \a progress is notified after each step if not 0.
+			///
+			/// Throws cppdb_error if the backup fails or aborted by \a progress
+			///
+			virtual void backup_to(extension &target,int pages_per_step,backup_progress *progress,int sleep_ms) = 0;
+		protected:
+			~extension() {}
+		};
+
+		/// \cond INTERNAL
+		namespace details {
+			template<int... I>
+			struct indices {};
+			template<int N,int... I>
+			struct make_indices : public make_indices<N-1,N-1,I...> {};
+			template<int... I>
+			struct make_indices<0,I...> {
+				typedef indices<I...> type;
+			};
+
+			template<typename R,typename... Args>
+			struct signature {
+				typedef R result_type;
+				typedef std::tuple<typename std::decay<Args>::type...> arguments_type;
+				static const int arity = sizeof...(Args);
+			};
+
+			template<typename F>
+			struct callable_traits : public callable_traits<decltype(&F::operator())> {};
+			template<typename R,typename... Args>
+			struct callable_traits<R(*)(Args...)> : public signature<R,Args...> {};
+			template<typename R,typename... Args>
+			struct callable_traits<R(Args...)> : public signature<R,Args...> {};
+			template<typename C,typename R,typename... Args>
+			struct callable_traits<R(C::*)(Args...)> : public signature<R,Args...> {};
+			template<typename C,typename R,typename... Args>
+			struct callable_traits<R(C::*)(Args...) const> : public signature<R,Args...> {};
+
+			template<typename T,bool Integral = std::is_integral<T>::value,bool Real = std::is_floating_point<T>::value>
+			struct value_traits;
+
+			template<typename T>
+			struct value_traits<T,true,false> {
+				static T get(function_arguments &a,int i)
+				{
+					long long v = a.get_int64(i);
+					T tmp = static_cast<T>(v);
+					if(static_cast<long long>(tmp)!=v || (v < 0 && !std::numeric_limits<T>::is_signed))
+						throw bad_value_cast();
+					return tmp;
+				}
+				static void set(function_result &r,T v)
+				{
+					if(!std::numeric_limits<T>::is_signed
+					   && static_cast<unsigned long long>(v) > static_cast<unsigned long long>(std::numeric_limits<long long>::max()))
+					{
+						throw bad_value_cast();
+					}
+					r.set(static_cast<long long>(v));
+				}
+			};
+			template<>
+			struct value_traits<bool,true,false> {
+				static bool get(function_arguments &a,int i)
+				{
+					return a.get_int64(i)!=0;
+				}
+				static void set(function_result &r,bool v)
+				{
+					r.set(static_cast<long long>(v));
+				}
+			};
+			template<typename T>
+			struct value_traits<T,false,true> {
+				static T get(function_arguments &a,int i)
+				{
+					return static_cast<T>(a.get_double(i));
+				}
+				static void set(function_result &r,T v)
+				{
+					r.set(static_cast<double>(v));
+				}
+			};
+			template<>
+			struct value_traits<std::string,false,false> {
+				static std::string get(function_arguments &a,int i)
+				{
+					size_t len = 0;
+					char const *s = a.get_text(i,len);
+					return std::string(s,len);
+				}
+				static void set(function_result &r,std::string const &v)
+				{
+					r.set(v.c_str(),v.c_str()+v.size());
+				}
+			};
+			template<>
+			struct value_traits<char const *,false,false> {
+				static void set(function_result &r,char const *v)
+				{
+					if(v)
+						r.set(v,v+strlen(v));
+					else
+						r.set_null();
+				}
+			};
+
+			inline bool has_nulls(function_arguments &a)
+			{
+				for(int i=0;i<a.size();i++) {
+					if(a.is_null(i))
+						return true;
+				}
+				return false;
+			}
+
+			template<typename F>
+			class scalar_function_impl : public scalar_function {
+			public:
+				typedef callable_traits<F> traits;
+				typedef typename std::decay<typename traits::result_type>::type result_type;
+				typedef typename traits::arguments_type arguments_type;
+
+				scalar_function_impl(F const &f) : f_(f) {}
+				virtual void call(function_result &r,function_arguments &a)
+				{
+					if(has_nulls(a)) {
+						r.set_null();
+						return;
+					}
+					invoke(r,a,typename make_indices<traits::arity>::type());
+				}
+			private:
+				template<int... I>
+				void invoke(function_result &r,function_arguments &a,indices<I...>)
+				{
+					value_traits<result_type>::set(r,f_(value_traits<typename std::tuple_element<I,arguments_type>::type>::get(a,I)...));
+				}
+				F f_;
+			};
+
+			template<typename State,bool Window>
+			class aggregate_state_impl : public aggregate_state {
+			public:
+				typedef callable_traits<decltype(&State::step)> traits;
+				typedef typename traits::arguments_type arguments_type;
+				typedef typename std::decay<decltype(std::declval<State &>().result())>::type result_type;
+
+				virtual void step(function_arguments &a)
+				{
+					if(has_nulls(a))
+						return;
+					invoke_step(a,typename make_indices<traits::arity>::type());
+				}
+				virtual void inverse(function_arguments &a)
+				{
+					if(has_nulls(a))
+						return;
+					invoke_inverse(a,std::integral_constant<bool,Window>(),typename make_indices<traits::arity>::type());
+				}
+				virtual void value(function_result &r)
+				{
+					value_traits<result_type>::set(r,state_.result());
+				}
+			private:
+				template<int... I>
+				void invoke_step(function_arguments &a,indices<I...>)
+				{
+					state_.step(value_traits<typename std::tuple_element<I,arguments_type>::type>::get(a,I)...);
+				}
+				template<int... I>
+				void invoke_inverse(function_arguments &a,std::true_type,indices<I...>)
+				{
+					state_.inverse(value_traits<typename std::tuple_element<I,arguments_type>::type>::get(a,I)...);
+				}
+				template<int... I>
+				void invoke_inverse(function_arguments &,std::false_type,indices<I...>)
+				{
+					throw not_supported_by_backend("cppdb::sqlite3: inverse called for non-window aggregate");
+				}
+				State state_;
+			};
+
+			template<typename State,bool Window>
+			class aggregate_function_impl : public aggregate_function {
+			public:
+				typedef typename aggregate_state_impl<State,Window>::traits traits;
+				virtual aggregate_state *create()
+				{
+					return new aggregate_state_impl<State,Window>();
+				}
+			};
+
+			inline extension &get_extension(session &sql)
+			{
+				extension *ext = sql.get_extension<extension>();
+				if(!ext)
+					throw not_supported_by_backend("cppdb::sqlite3: the session does not use the sqlite3 driver");
+				return *ext;
+			}
+
+			template<typename F>
+			class backup_progress_impl : public backup_progress {
+			public:
+				backup_progress_impl(F const &f) : f_(f) {}
+				virtual bool step(int remaining,int total)
+				{
+					return f_(remaining,total);
+				}
+			private:
+				F f_;
+			};
+		} // details
+		/// \endcond
+
+		///
+		/// Register a scalar function \a name on the sqlite3 connection of session \a sql.
+		///
+		/// \a f is any callable object or function pointer; its argument and result types define
+		/// the conversion of SQL values: integral types, floating point types and std::string are
+		/// supported. If any of the arguments is NULL the function is not called and the result is NULL.
+		///
+		/// \code
+		///   cppdb::sqlite3_backend::create_function(sql,"distance",
+		///       [](double x,double y) { return std::sqrt(x*x + y*y); });
+		///   sql << "SELECT id FROM points WHERE distance(x,y) < ?" << r;
+		/// \endcode
+		///
+		template<typename F>
+		void create_function(session &sql,std::string const &name,F f,bool deterministic = true)
+		{
+			typedef details::scalar_function_impl<F> impl_type;
+			ref_ptr<scalar_function> p(new impl_type(f));
+			details::get_extension(sql).create_function(name,impl_type::traits::arity,p,deterministic);
+		}
+
+		///
+		/// Register an aggregate function \a name on the sqlite3 connection of session \a sql.
+		///
+		/// \a State is default constructible class, a new instance is created for each group and it
+		/// should have following members:
+		///
+		/// - void step(Args...) - add a row, the arguments define the arguments of SQL function
+		/// - R result() - get the aggregate value
+		///
+		/// Rows with NULL arguments are skipped as in standard SQL aggregates.
+		///
+		template<typename State>
+		void create_aggregate(session &sql,std::string const &name,bool deterministic = true)
+		{
+			typedef details::aggregate_function_impl<State,false> impl_type;
+			ref_ptr<aggregate_function> p(new impl_type());
+			details::get_extension(sql).create_aggregate(name,impl_type::traits::arity,p,deterministic);
+		}
+
+		///
+		/// Register an aggregate window function \a name on the sqlite3 connection of session \a sql.
+		///
+		/// Same as create_aggregate() but \a State should also have void inverse(Args...) member that removes
+		/// a row that left the window frame. result() may be called multiple times.
+		///
+		template<typename State>
+		void create_window_function(session &sql,std::string const &name,bool deterministic = true)
+		{
+			typedef details::aggregate_function_impl<State,true> impl_type;
+			ref_ptr<aggregate_function> p(new impl_type());
+			details::get_extension(sql).create_window_function(name,impl_type::traits::arity,p,deterministic);
+		}
+
+		///
+		/// Copy the database of session \a source to the database of session \a target, both should
+		/// use sqlite3 driver, see extension::backup_to() for details.
+		///
+		inline void backup(session &source,session &target,int pages_per_step = -1,int sleep_ms = 0)
+		{
+			details::get_extension(source).backup_to(details::get_extension(target),pages_per_step,0,sleep_ms);
+		}
+
+		///
+		/// Copy the database of session \a source to the database of session \a target in steps of \a pages_per_step
+		/// pages, calling \a progress after each step. \a progress is callable object with signature
+		/// bool(int remaining,int total), returning false aborts the backup.
+		///
+		/// \code
+		///   cppdb::sqlite3_backend::backup(live,copy,[](int remaining,int total) {
+		///       std::cout << (total - remaining) << "/" << total << std::endl;
+		///       return true;
+		///   },1024,10);
+		/// \endcode
+		///
+		template<typename F>
+		void backup(session &source,session &target,F progress,int pages_per_step,int sleep_ms = 0)
+		{
+			details::backup_progress_impl<F> p(progress);
+			details::get_extension(source).backup_to(details::get_extension(target),pages_per_step,&p,sleep_ms);
+		}
+
+		///
+		/// Create a snapshot of the database of \a source in memory and return the session that
+		/// holds it.
+		///
+		/// By default a private ":memory:" database is created, \a target_connection_string may specify other
+		/// sqlite3 connection, for example db='file:replica?mode=memory&cache=shared' that is shared
+		/// by all connections of the process, such that a pool can serve it as in-RAM read-only replica
+		/// as long as the returned session is alive.
+		///
+		inline session clone_to_memory(	session &source,
+						std::string const &target_connection_string = "sqlite3:db=:memory:",
+						int pages_per_step = -1,
+						int sleep_ms = 0)
+		{
+			session target(target_connection_string);
+			backup(source,target,pages_per_step,sleep_ms);
+			return target;
+		}
+
+	} // sqlite3_backend
+} // cppdb
+
+#endif
@@ -21,6 +21,7 @@
 #include <cppdb/defs.h>
 #include <string>
 #include <ctime>
+#include <chrono>
 #include <map>
 #include <vector>
 
@@ -51,6 +52,118 @@ namespace cppdb {
 	CPPDB_API std::tm parse_date(std::string const &v);
 	CPPDB_API std::tm parse_time(std::string const &v);
 	CPPDB_API std::tm parse_datetime(std::string const &v);
+	///
+	/// \brief parse the text [b,e) as date & time value.
+	///
+	/// The text is ISO-8601 "YYYY-MM-DD", "HH:MM:SS" or "YYYY-MM-DD HH:MM:SS" where 'T' can be used instead
+	/// of the space. Seconds may have a fractional part and may be followed by a time zone offset "Z", "+HH",
+	/// "+HH:MM" or "+HHMM". The fields are validated, the fractional part and the offset are ignored and
+	/// tm_isdst is set to -1. Throws bad_value_cast if the text is not valid.
+	///
+	/// Used by backend implementations;
+	///
+	CPPDB_API std::tm parse_date(char const *b,char const *e);
+	CPPDB_API std::tm parse_time(char const *b,char const *e);
+	CPPDB_API std::tm parse_datetime(char const *b,char const *e);
+
+	///
+	/// The size of the buffer that is enough for the date-time and decimal formatting functions that write to a buffer
+	///
+	static const int datetime_buffer_size = 64;
+
+	///
+	/// \brief format a date & time value to \a buf that is at least datetime_buffer_size long
+	/// and return the end of the written text.
+	///
+	/// Used by backend implementations;
+	///
+	CPPDB_API char *format_date(char *buf,std::tm const &v);
+	CPPDB_API char *format_time(char *buf,std::tm const &v);
+	CPPDB_API char *format_datetime(char *buf,std::tm const &v);
+
+	///
+	/// A point in time with microsecond precision, same as std::chrono::sys_time<std::chrono::microseconds>
+	///
+	typedef std::chrono::time_point<std::chrono::system_clock,std::chrono::microseconds> sys_microseconds;
+
+	///
+	/// \brief parse the text [b,e) as a point in time.
+	///
+	/// The format is the same as of parse_datetime(char const *,char const *) but the date is required. The time
+	/// without an offset is considered UTC. Microseconds are preserved. Throws bad_value_cast if the text is not valid.
+	///
+	CPPDB_API sys_microseconds parse_timestamp(char const *b,char const *e);
+	///
+	/// \copydoc parse_timestamp(char const *,char const *)
+	///
+	CPPDB_API sys_microseconds parse_timestamp(std::string const &v);
+	///
+	/// \brief format a point in time as UTC "YYYY-MM-DD HH:MM:SS.ffffff" to \a buf that is at least datetime_buffer_size
+	/// long and return the end of the written text. The fractional part is written only if it is not zero.
+	///
+	CPPDB_API char *format_timestamp(char *buf,sys_microseconds v);
+	///
+	/// \brief format a point in time as UTC "YYYY-MM-DD HH:MM:SS.ffffff"
+	///
+	CPPDB_API std::string format_timestamp(sys_microseconds v);
+	///
+	/// \brief create a point in time from UTC date and time fields, the fields are not validated
+	///
+	CPPDB_API sys_microseconds make_timestamp(int year,int month,int day,int hour,int minute,int second,int microsecond = 0);
+	///
+	/// \brief split a point in time into UTC date and time fields, the sub-second part is dropped
+	///
+	CPPDB_API std::tm timestamp_to_tm(sys_microseconds v);
+
+	///
+	/// \brief A decimal number - a 128 bit integer \a value scaled by 10 to the power of -\a scale.
+	///
+	/// The value is stored as two's complement 128 bit integer split into \a high and \a low parts, for
+	/// example 123.45 is high=0, low=12345, scale=2 and -1 is high=-1, low=0xFFFFFFFFFFFFFFFF, scale=0
+	///
+	struct decimal {
+		decimal() : high(0), low(0), scale(0) {}
+		///
+		/// Create a decimal from an integer \a v scaled by 10 to the power of -\a s
+		///
+		decimal(long long v,int s = 0) : high(v < 0 ? -1 : 0), low(static_cast<unsigned long long>(v)), scale(s) {}
+		/// The upper 64 bits of the value
+		long long high;
+		/// The lower 64 bits of the value
+		unsigned long long low;
+		/// The number of decimal digits after the point, 0 to 38
+		int scale;
+
+		/// Same value and scale
+		bool operator==(decimal const &other) const
+		{
+			return high == other.high && low == other.low && scale == other.scale;
+		}
+		/// Different value or scale
+		bool operator!=(decimal const &other) const
+		{
+			return !(*this == other);
+		}
+	};
+
+	///
+	/// \brief parse the text [b,e) as a decimal number like "-123.4500", the scale is the number of digits after
+	/// the point. Throws bad_value_cast if the text is not a number or it does not fit 128 bits.
+	///
+	CPPDB_API decimal parse_decimal(char const *b,char const *e);
+	///
+	/// \copydoc parse_decimal(char const *,char const *)
+	///
+	CPPDB_API decimal parse_decimal(std::string const &v);
+	///
+	/// \brief format a decimal number to \a buf that is at least datetime_buffer_size long and return the end of the
+	/// written text, all the digits after the point given by the scale are written.
+	///
+	CPPDB_API char *format_decimal(char *buf,decimal const &v);
+	///
+	/// \brief format a decimal number
+	///
+	CPPDB_API std::string format_decimal(decimal const &v);
 
 	///
 	/// \brief Parse a connection string \a cs into driver name \a driver_name and list of properties \a props
@@ -86,6 +199,8 @@ namespace cppdb {
 	///
 	/// replace all occurences of a python style variable to dict format
 	///
+	/// See format_template for the syntax of the placeholder, "%%" is left as is.
+	///
 	std::string str_replace_format(
 		std::string const &sHaystack, std::string const &sNeedle, 
 		std::string const &sReplace, 
@@ -106,7 +221,10 @@ namespace cppdb {
 	///
 	/// \brief Class that represents parsed key value properties file
 	///
+	class format_template;
+
 	class CPPDB_API properties {
+		friend class format_template;
 	public:
 		///
 		/// Type that represent key, values set
@@ -135,7 +253,9 @@ namespace cppdb {
 		///
 		std::string dump() const;
 		///
-		/// String format using the values of properties
+		/// String format using the values of properties, same as format_template(fmt).render(*this,formater)
+		///
+		/// The compiled templates are cached, so formatting with the same \a fmt again does not parse it
 		///
 		std::string format(std::string const &fmt, std::string (*formater)(std::string const &)=NULL) const;
 		
@@ -149,6 +269,44 @@ namespace cppdb {
 		properties_type properties_;
 	};
 
+	///
+	/// \brief A python style template like "create table %(table)s" parsed into literal text and placeholders
+	///
+	/// A placeholder is a '%' that is not escaped as "%%", optional flags, the name in parentheses and
+	/// a lower case conversion letter, for example "%(name)s" or "%-10(name)s". The flags and the conversion
+	/// are ignored.
+	///
+	class CPPDB_API format_template {
+	public:
+		///
+		/// Create an empty template
+		///
+		format_template();
+		///
+		/// Parse the template \a fmt
+		///
+		explicit format_template(std::string const &fmt);
+		///
+		/// Render the template substituting the placeholders by the values of \a props passed through
+		/// \a formater if given. Placeholders not found in \a props are kept as is. Every "%%" in the
+		/// text and in the values is rendered as "%".
+		///
+		std::string render(properties const &props, std::string (*formater)(std::string const &)=NULL) const;
+		///
+		/// The number of placeholders in the template
+		///
+		size_t placeholders() const;
+	private:
+		struct segment {
+			bool placeholder;
+			std::string text; // literal text or the placeholder name
+			std::string raw; // the placeholder as written
+		};
+		std::vector<segment> segments_;
+		size_t literal_size_;
+		size_t placeholders_;
+	};
+
 	///
 	/// \brief Class that represents parsed connection string
 	///
@@ -177,6 +335,21 @@ namespace cppdb {
 			parse_connection_string(cs,driver,properties_);
 		}
 		std::string conn_str(std::string const &delimiter, std::string (*formater)(std::string const &)=NULL) const;
+		///
+		/// The hash of the connection string, the key of the connection pools and of the parsed
+		/// connection strings in the connections_manager
+		///
+		size_t hash() const
+		{
+			return hash(connection_string);
+		}
+		///
+		/// The hash of the connection string \a cs, same as connection_info(cs).hash() without parsing it
+		///
+		static size_t hash(std::string const &cs)
+		{
+			return std::hash<std::string>()(cs);
+		}
 
 	};
 
@@ -50,8 +50,106 @@ public:
 	{
 	}
 };
+///
+/// Unbuffered result that occupies the connection until all its rows are read
+///
+class streaming_result {
+public:
+	///
+	/// Discard remaining rows, after this call the result can't be used
+	///
+	virtual void drain() = 0;
+protected:
+	~streaming_result() {}
+};
+
+///
+/// The state of the connection shared with its statements
+///
+struct connection_state {
+	connection_state() : 
+		stream(false),
+		active(0),
+		owner(0)
+	{
+	}
+	///
+	/// Register unbuffered result \a r created by statement \a o
+	///
+	void start(streaming_result *r,void const *o)
+	{
+		active = r;
+		owner = o;
+	}
+	///
+	/// Make the connection ready for new query by discarding the active unbuffered result
+	///
+	void release()
+	{
+		if(active) {
+			streaming_result *r = active;
+			active = 0;
+			owner = 0;
+			r->drain();
+		}
+	}
+	///
+	/// Called by unbuffered result when it is completed or destroyed
+	///
+	void done(streaming_result *r)
+	{
+		if(active == r) {
+			active = 0;
+			owner = 0;
+		}
+	}
+	bool stream;
+	streaming_result *active;
+	void const *owner;
+};
+
+///
+/// Discard all pending result sets of the last query, errors are ignored
+///
+inline void skip_results(MYSQL *conn)
+{
+	while(mysql_more_results(conn)) {
+		if(mysql_next_result(conn)!=0)
+			break;
+		MYSQL_RES *r = mysql_use_result(conn);
+		if(r)
+			mysql_free_result(r);
+	}
+}
+
+///
+/// Read the status of all statements executed by the last query, throws if one of them failed
+/// or if \a allow_results is false and one of them produced a result set
+///
+inline void complete_query(MYSQL *conn,bool allow_results)
+{
+	bool has_result = false;
+	for(;;) {
+		MYSQL_RES *r = mysql_store_result(conn);
+		if(r) {
+			has_result = true;
+			mysql_free_result(r);
+		}
+		else if(mysql_errno(conn)) {
+			throw cppdb_myerror(mysql_error(conn));
+		}
+		int status = mysql_next_result(conn);
+		if(status > 0)
+			throw cppdb_myerror(mysql_error(conn));
+		if(status < 0)
+			break;
+	}
+	if(has_result && !allow_results)
+		throw cppdb_myerror("Calling exec() on query!");
+}
+
 namespace unprep {
-	class result : public backend::result {
+	class result : public backend::result, public streaming_result {
 	public:
 
 		///
@@ -62,6 +160,8 @@ namespace unprep {
 		{
 			if(!res_)
 				return last_row_reached;
+			if(state_->stream)
+				return next_row_unknown;
 			if(current_row_ >= mysql_num_rows(res_))
 				return last_row_reached;
 			else
@@ -73,14 +173,57 @@ namespace unprep {
 		///
 		virtual bool next() 
 		{
+			if(drained_)
+				throw cppdb_myerror("The unbuffered result was discarded as the connection was used by other query");
 			if(!res_)
 				return false;
 			current_row_ ++;
 			row_ = mysql_fetch_row(res_);
-			if(!row_)
+			if(!row_) {
+				if(state_->stream) {
+					if(!mysql_more_results(conn_))
+						state_->done(this);
+					if(mysql_errno(conn_))
+						throw cppdb_myerror(mysql_error(conn_));
+				}
+				return false;
+			}
+			return true;
+		}
+		virtual bool next_result()
+		{
+			if(drained_ || skipped_)
+				throw cppdb_myerror("The result sets were discarded as the connection was used by other query");
+			if(res_) {
+				mysql_free_result(res_);
+				res_ = 0;
+			}
+			row_ = 0;
+			current_row_ = 0;
+			cols_ = 0;
+			// pending result sets keep the connection occupied by this result
+			if(state_->active != this)
+				return false;
+			if(!fetch_result_set()) {
+				state_->done(this);
 				return false;
+			}
 			return true;
 		}
+		virtual void drain()
+		{
+			if(state_->stream) {
+				if(res_) {
+					// fetches remaining rows of unbuffered result
+					mysql_free_result(res_);
+					res_ = 0;
+				}
+				row_ = 0;
+				drained_ = true;
+			}
+			skip_results(conn_);
+			skipped_ = true;
+		}
 		///
 		/// Fetch an integer value for column \a col starting from 0.
 		///
@@ -89,7 +232,7 @@ namespace unprep {
 		///
 		char const *at(int col)
 		{
-			if(!res_)
+			if(!res_ || !row_)
 				throw empty_row_access();
 			if(col < 0 || col >= cols_)
 				throw invalid_column();
@@ -98,7 +241,7 @@ namespace unprep {
 
 		char const *at(int col,size_t &len)
 		{
-			if(!res_)
+			if(!res_ || !row_)
 				throw empty_row_access();
 			if(col < 0 || col >= cols_)
 				throw invalid_column();
@@ -116,7 +259,7 @@ namespace unprep {
 			char const *s=at(col,len);
 			if(!s)
 				return false;
-			v = parse_number<T>(std::string(s,len),fmt_);
+			v = parse_number<T>(s,s+len);
 			return true;
 		}
 		virtual bool fetch(int col,short &v) 
@@ -196,8 +339,36 @@ namespace unprep {
 			char const *s=at(col,len);
 			if(!s)
 				return false;
-			std::string tmp(s,len);
-			v = parse_datetime(tmp);
+			v = parse_datetime(s,s+len);
+			return true;
+		}
+		virtual bool fetch(int col,sys_microseconds &v) 
+		{
+			size_t len;
+			char const *s=at(col,len);
+			if(!s)
+				return false;
+			switch(mysql_fetch_fields(res_)[col].type) {
+			case MYSQL_TYPE_TINY:
+			case MYSQL_TYPE_SHORT:
+			case MYSQL_TYPE_INT24:
+			case MYSQL_TYPE_LONG:
+			case MYSQL_TYPE_LONGLONG:
+				// integer columns keep microseconds since the epoch
+				v = sys_microseconds(std::chrono::microseconds(parse_number<long long>(s,s+len)));
+				break;
+			default:
+				v = parse_timestamp(s,s+len);
+			}
+			return true;
+		}
+		virtual bool fetch(int col,decimal &v) 
+		{
+			size_t len;
+			char const *s=at(col,len);
+			if(!s)
+				return false;
+			v = parse_decimal(s,s+len);
 			return true;
 		}
 		///
@@ -242,35 +413,84 @@ namespace unprep {
 
 		// End of API
 		
-		result(MYSQL *conn) : 
+		result(MYSQL *conn,connection_state *state) : 
+			conn_(conn),
+			state_(state),
 			res_(0),
 			cols_(0),
 			current_row_(0),
-			row_(0)
+			row_(0),
+			drained_(false),
+			skipped_(false)
 		{
-			fmt_.imbue(std::locale::classic());
-			res_ = mysql_store_result(conn);
+			res_ = state_->stream ? mysql_use_result(conn) : mysql_store_result(conn);
 			if(!res_) {
+				if(mysql_errno(conn))
+					throw cppdb_myerror(mysql_error(conn));
 				cols_ = mysql_field_count(conn);
-				if(cols_ == 0)
-					throw cppdb_myerror("Seems that the query does not produce any result");
+				if(cols_ == 0) {
+					// leading statements of a batch that do not return rows
+					bool found = false;
+					try {
+						found = fetch_result_set();
+					}
+					catch(...) {
+						skip_results(conn_);
+						throw;
+					}
+					if(!found)
+						throw cppdb_myerror("Seems that the query does not produce any result");
+				}
 			}
 			else {
 				cols_ = mysql_num_fields(res_);
+				if(state_->stream || mysql_more_results(conn_))
+					state_->start(this,res_);
 			}
 
 		}
 		~result()
 		{
+			if(state_->active == this)
+				state_->release();
 			if(res_)
 				mysql_free_result(res_);
 		}
 	private:
-		std::istringstream fmt_;
+		//
+		// Move to the next result set that has columns, the connection remains
+		// occupied by this result as long as there are pending result sets
+		//
+		bool fetch_result_set()
+		{
+			for(;;) {
+				int status = mysql_next_result(conn_);
+				if(status > 0)
+					throw cppdb_myerror(mysql_error(conn_));
+				if(status < 0)
+					return false;
+				res_ = state_->stream ? mysql_use_result(conn_) : mysql_store_result(conn_);
+				if(!res_) {
+					if(mysql_errno(conn_))
+						throw cppdb_myerror(mysql_error(conn_));
+					continue;
+				}
+				cols_ = mysql_num_fields(res_);
+				if(state_->stream || mysql_more_results(conn_))
+					state_->start(this,res_);
+				else
+					state_->done(this);
+				return true;
+			}
+		}
+		MYSQL *conn_;
+		connection_state *state_;
 		MYSQL_RES *res_;
 		int cols_;
 		unsigned current_row_;
 		MYSQL_ROW row_;
+		bool drained_;
+		bool skipped_;
 	};
 	
 	class statement : public backend::statement {
@@ -290,13 +510,17 @@ namespace unprep {
 		}
 		virtual void bind(int col,char const *b,char const *e) 
 		{
-			std::vector<char> buf(2*(e-b)+1);
-			size_t len = mysql_real_escape_string(conn_,&buf.front(),b,e-b);
 			std::string &s=at(col);
 			s.clear();
-			s.reserve(e-b+2);
 			s+='\'';
-			s.append(&buf.front(),len);
+			if(needs_escaping(b,e)) {
+				escape_buf_.resize(2*(e-b)+1);
+				size_t len = mysql_real_escape_string(conn_,&escape_buf_.front(),b,e-b);
+				s.append(&escape_buf_.front(),len);
+			}
+			else {
+				s.append(b,e-b);
+			}
 			s+='\'';
 		}
 		virtual void bind(int col,std::tm const &v) 
@@ -304,10 +528,25 @@ namespace unprep {
 			std::string &s = at(col);
 			s.clear();
 			s.reserve(30);
+			char buf[datetime_buffer_size];
+			s+='\'';
+			s.append(buf,cppdb::format_datetime(buf,v));
+			s+='\'';
+		}
+		virtual void bind(int col,sys_microseconds const &v) 
+		{
+			std::string &s = at(col);
+			s.clear();
+			char buf[datetime_buffer_size];
 			s+='\'';
-			s+=cppdb::format_datetime(v);
+			s.append(buf,cppdb::format_timestamp(buf,v));
 			s+='\'';
 		}
+		virtual void bind(int col,decimal const &v) 
+		{
+			char buf[datetime_buffer_size];
+			at(col).assign(buf,cppdb::format_decimal(buf,v));
+		}
 		virtual void bind(int col,std::istream &v)
 		{
 			std::ostringstream ss;
@@ -318,12 +557,9 @@ namespace unprep {
 		template<typename T>
 		void do_bind(int col,T v)
 		{
-			fmt_.str(std::string());
-			if(!std::numeric_limits<T>::is_integer)
-				fmt_ << std::setprecision(std::numeric_limits<T>::digits10+1);
-			fmt_ << v;
-			std::string tmp = fmt_.str();
-			at(col).swap(tmp);
+			char buf[number_buffer_size];
+			char *end = format_number(buf,v);
+			at(col).assign(buf,end-buf);
 		}
 		virtual void bind(int col,int v)
 		{
@@ -365,53 +601,56 @@ namespace unprep {
 		{
 			return mysql_insert_id(conn_);
 		}
+		virtual backend::result *exec_returning(std::vector<std::string> const &columns)
+		{
+			// there is no RETURNING and only the first id of a multiple row insert is reported,
+			// the others depend on auto_increment_increment and on the rows that were ignored or updated
+			if(columns.size() != 1)
+				throw not_supported_by_backend("cppdb::mysql::exec_returning of several columns is not supported");
+			exec();
+			long long id = sequence_last(std::string());
+			if(affected() != 1 || id == 0)
+				throw not_supported_by_backend("cppdb::mysql::exec_returning is supported for a single inserted row only");
+			return generated_keys(columns[0],id,1);
+		}
 		virtual unsigned long long affected()
 		{
 			return mysql_affected_rows(conn_);
 		}
 		
-		void bind_all(std::string &real_query)
+		//
+		// Render the query into real_query_, the buffer is kept between executions
+		//
+		void bind_all()
 		{
-			size_t total = query_.size();
+			real_query_.clear();
 			for(unsigned i=0;i<params_.size();i++) {
-				total+=params_[i].size();
+				real_query_ += fragments_[i];
+				real_query_ += params_[i];
 			}
-			real_query.clear();
-			real_query.reserve(total);
-			size_t pos_ = 0;
-			for(unsigned i=0;i<params_.size();i++) {
-				size_t marker = binders_[i];
-				real_query.append(query_,pos_,marker-pos_);
-				pos_ = marker+1;
-				real_query.append(params_[i]);
-			}
-			real_query.append(query_,pos_,std::string::npos);
+			real_query_ += fragments_.back();
 		}
 
 		virtual result *query() 
 		{
-			std::string real_query;	
-			bind_all(real_query);
+			bind_all();
 			reset_params();
-			if(mysql_real_query(conn_,real_query.c_str(),real_query.size())) {
+			state_->release();
+			if(mysql_real_query(conn_,real_query_.c_str(),real_query_.size())) {
 				throw cppdb_myerror(mysql_error(conn_));
 			}
-			return new result(conn_);
+			return new(get_arena()) result(conn_,state_);
 		}
 		
 		virtual void exec() 
 		{
-			std::string real_query;	
-			bind_all(real_query);
+			bind_all();
 			reset_params();
-			if(mysql_real_query(conn_,real_query.c_str(),real_query.size())) {
+			state_->release();
+			if(mysql_real_query(conn_,real_query_.c_str(),real_query_.size())) {
 				throw cppdb_myerror(mysql_error(conn_));
 			}
-			MYSQL_RES *r=mysql_store_result(conn_);
-			if(r){
-				mysql_free_result(r);
-				throw cppdb_myerror("Calling exec() on query!");
-			}
+			complete_query(conn_,false);
 		}
 
 		std::string &at(int col)
@@ -423,29 +662,51 @@ namespace unprep {
 		}
 		void reset_params()
 		{
-			params_.clear();
-			params_.resize(params_no_,"NULL");
+			// keeps the capacity of the values for the next execution
+			params_.resize(params_no_);
+			for(unsigned i=0;i<params_.size();i++)
+				params_[i].assign("NULL",4);
+		}
+		static bool needs_escaping(char const *b,char const *e)
+		{
+			for(;b!=e;++b) {
+				switch(*b) {
+				case '\0':
+				case '\n':
+				case '\r':
+				case '\\':
+				case '\'':
+				case '"':
+				case '\032':
+					return true;
+				}
+			}
+			return false;
 		}
 		
-		statement(std::string const &q,MYSQL *conn) :
+		statement(std::string const &q,MYSQL *conn,connection_state *state) :
 			query_(q),
 			conn_(conn),
+			state_(state),
 			params_no_(0)
 		{
-			fmt_.imbue(std::locale::classic());
 			bool inside_text = false;
+			size_t pos = 0;
 			for(size_t i=0;i<query_.size();i++) {
 				if(query_[i]=='\'') {
 					inside_text=!inside_text;
 				}
 				if(query_[i]=='?' && !inside_text) {
 					params_no_++;
-					binders_.push_back(i);
+					fragments_.push_back(query_.substr(pos,i-pos));
+					pos = i+1;
 				}
 			}
 			if(inside_text) {
 				throw cppdb_myerror("Unterminated string found in query");
 			}
+			fragments_.push_back(query_.substr(pos));
+			real_query_.reserve(query_.size() + 16 * params_no_);
 			reset_params();
 		}
 		virtual ~statement()
@@ -453,38 +714,56 @@ namespace unprep {
 		}
 		virtual void reset()
 		{
+			reset_params();
 		}
 
 	private:
-		std::ostringstream fmt_;
 		std::vector<std::string> params_;
-		std::vector<size_t> binders_;
+		// the query split by placeholders, params_no_ + 1 fragments
+		std::vector<std::string> fragments_;
+		std::string real_query_;
+		std::vector<char> escape_buf_;
 
 		std::string query_;
 		MYSQL *conn_;
+		connection_state *state_;
 		int params_no_;
 	};
 } // uprep
 
 namespace prep {
 
-	class result : public backend::result {
+	class result : public backend::result, public streaming_result {
+		//
+		// Column buffer, bound once per result: integers are received as 64 bit integers,
+		// doubles as double, dates and timestamps as MYSQL_TIME and all other types as text
+		//
 		struct bind_data {
 			bind_data() :
-				ptr(0),
+				type(MYSQL_TYPE_STRING),
+				is_unsigned(false),
+				date_only(false),
+				int_value(0),
+				real_value(0),
+				time_value(),
 				length(0),
 				is_null(0),
 				error(0)
 			{
-				memset(&buf,0,sizeof(buf));
 			}
-			char buf[128];
-			std::vector<char> vbuf;
-			char *ptr;
+			enum_field_types type;
+			bool is_unsigned;
+			bool date_only;
+			long long int_value;
+			double real_value;
+			MYSQL_TIME time_value;
+			std::vector<char> buf;
 			unsigned long length;
 			my_bool is_null;
 			my_bool error;
 		};
+		// initial size of text buffer if the maximal length is not known
+		static const unsigned long default_buffer_size = 128;
 	public:
 
 		///
@@ -493,6 +772,10 @@ namespace prep {
 		///
 		virtual next_row has_next() 
 		{
+			if(done_)
+				return last_row_reached;
+			if(state_->stream)
+				return next_row_unknown;
 			if(current_row_ >= mysql_stmt_num_rows(stmt_))
 				return last_row_reached;
 			else
@@ -504,29 +787,42 @@ namespace prep {
 		///
 		virtual bool next() 
 		{
+			if(drained_)
+				throw cppdb_myerror("The unbuffered result was discarded as the connection was used by other query");
+			if(done_)
+				return false;
 			current_row_ ++;
-			reset();
-			if(cols_ > 0) {
-				if(mysql_stmt_bind_result(stmt_,&bind_[0])) {
-					throw cppdb_myerror(mysql_stmt_error(stmt_));
-				}
-			}
 			int r = mysql_stmt_fetch(stmt_);
 			if(r==MYSQL_NO_DATA) { 
+				done_ = true;
+				if(!mysql_more_results(conn_))
+					state_->done(this);
 				return false;
 			}
+			if(r!=0 && r!=MYSQL_DATA_TRUNCATED) {
+				done_ = true;
+				state_->done(this);
+				throw cppdb_myerror(mysql_stmt_error(stmt_));
+			}
 			if(r==MYSQL_DATA_TRUNCATED) {
+				// happens only if the maximal length is not known in advance, grow the
+				// buffers so the following rows fit
+				bool grown = false;
 				for(int i=0;i<cols_;i++) {
-					if(bind_data_[i].error && !bind_data_[i].is_null && bind_data_[i].length >= sizeof(bind_data_[i].buf)) {
-						bind_data_[i].vbuf.resize(bind_data_[i].length);
-						bind_[i].buffer = &bind_data_[i].vbuf.front();
-						bind_[i].buffer_length = bind_data_[i].length;
+					bind_data &d = bind_data_[i];
+					if(d.error && !d.is_null && d.type == MYSQL_TYPE_STRING && d.length > d.buf.size()) {
+						d.buf.resize(d.length);
+						bind_[i].buffer = &d.buf.front();
+						bind_[i].buffer_length = d.buf.size();
 						if(mysql_stmt_fetch_column(stmt_,&bind_[i],i,0)) {
 							throw cppdb_myerror(mysql_stmt_error(stmt_));
 						}
-						bind_data_[i].ptr = &bind_data_[i].vbuf.front();
+						grown = true;
 					}
 				}
+				if(grown && mysql_stmt_bind_result(stmt_,&bind_[0])) {
+					throw cppdb_myerror(mysql_stmt_error(stmt_));
+				}
 			}
 			return true;
 		}
@@ -551,8 +847,21 @@ namespace prep {
 			bind_data &d=at(col);
 			if(d.is_null)
 				return false;
-
-			v=parse_number<T>(std::string(d.ptr,d.length),fmt_);
+			switch(d.type) {
+			case MYSQL_TYPE_LONGLONG:
+				if(d.is_unsigned)
+					v=numeric_cast<T>(static_cast<unsigned long long>(d.int_value));
+				else
+					v=numeric_cast<T>(d.int_value);
+				break;
+			case MYSQL_TYPE_DOUBLE:
+				v=numeric_cast<T>(d.real_value);
+				break;
+			case MYSQL_TYPE_DATETIME:
+				throw bad_value_cast();
+			default:
+				v=parse_number<T>(text(d),text(d)+d.length);
+			}
 			return true;
 		}
 		virtual bool fetch(int col,short &v) 
@@ -681,7 +990,16 @@ namespace prep {
 			bind_data &d=at(col);
 			if(d.is_null)
 				return false;
-			v.assign(d.ptr,d.length);
+			if(d.type == MYSQL_TYPE_STRING) {
+				v.assign(text(d),d.length);
+			}
+			else if(d.type == MYSQL_TYPE_DATETIME) {
+				char buf[datetime_buffer_size];
+				v.assign(buf,format_time(buf,d));
+			}
+			else {
+				v=format_number(d);
+			}
 			return true;
 		}
 		///
@@ -696,7 +1014,17 @@ namespace prep {
 			bind_data &d=at(col);
 			if(d.is_null)
 				return false;
-			v.write(d.ptr,d.length);
+			if(d.type == MYSQL_TYPE_STRING) {
+				v.write(text(d),d.length);
+			}
+			else if(d.type == MYSQL_TYPE_DATETIME) {
+				char buf[datetime_buffer_size];
+				v.write(buf,format_time(buf,d) - buf);
+			}
+			else {
+				std::string tmp = format_number(d);
+				v.write(tmp.c_str(),tmp.size());
+			}
 			return true;
 		}
 		///
@@ -708,10 +1036,61 @@ namespace prep {
 		///
 		virtual bool fetch(int col,std::tm &v) 
 		{
-			std::string tmp;
-			if(!fetch(col,tmp))
+			bind_data &d=at(col);
+			if(d.is_null)
 				return false;
-			v = parse_datetime(tmp);
+			if(d.type == MYSQL_TYPE_DATETIME)
+				v = timestamp_to_tm(to_timestamp(d.time_value));
+			else if(d.type == MYSQL_TYPE_STRING)
+				v = parse_datetime(text(d),text(d)+d.length);
+			else
+				throw bad_value_cast();
+			return true;
+		}
+		virtual bool fetch(int col,sys_microseconds &v) 
+		{
+			bind_data &d=at(col);
+			if(d.is_null)
+				return false;
+			switch(d.type) {
+			case MYSQL_TYPE_DATETIME:
+				v = to_timestamp(d.time_value);
+				break;
+			case MYSQL_TYPE_LONGLONG:
+				// integer columns keep microseconds since the epoch
+				if(d.is_unsigned)
+					v = sys_microseconds(std::chrono::microseconds(numeric_cast<long long>(static_cast<unsigned long long>(d.int_value))));
+				else
+					v = sys_microseconds(std::chrono::microseconds(d.int_value));
+				break;
+			case MYSQL_TYPE_STRING:
+				v = parse_timestamp(text(d),text(d)+d.length);
+				break;
+			default:
+				throw bad_value_cast();
+			}
+			return true;
+		}
+		virtual bool fetch(int col,decimal &v) 
+		{
+			bind_data &d=at(col);
+			if(d.is_null)
+				return false;
+			switch(d.type) {
+			case MYSQL_TYPE_LONGLONG:
+				v = decimal(d.int_value);
+				if(d.is_unsigned)
+					v.high = 0;
+				break;
+			case MYSQL_TYPE_STRING:
+				v = parse_decimal(text(d),text(d)+d.length);
+				break;
+			case MYSQL_TYPE_DOUBLE:
+				v = parse_decimal(format_number(d));
+				break;
+			default:
+				throw bad_value_cast();
+			}
 			return true;
 		}
 		///
@@ -752,94 +1131,336 @@ namespace prep {
 
 		// End of API
 		
-		result(MYSQL_STMT *stmt) : 
-			stmt_(stmt), current_row_(0),meta_(0)
+		result(MYSQL_STMT *stmt,MYSQL *conn,connection_state *state,backend::arena *memory) : 
+			stmt_(stmt),
+			conn_(conn),
+			state_(state),
+			current_row_(0),
+			meta_(0),
+			bind_(resource(memory)),
+			bind_data_(resource(memory)),
+			done_(false),
+			drained_(false)
+		{
+			open_result_set();
+		}
+		~result()
 		{
-			fmt_.imbue(std::locale::classic());
+			if(state_->active == this)
+				state_->release();
+			if(meta_)
+				mysql_free_result(meta_);
+		}
+		virtual bool next_result()
+		{
+			if(drained_)
+				throw cppdb_myerror("The result sets were discarded as the connection was used by other query");
+			mysql_stmt_free_result(stmt_);
+			if(meta_) {
+				mysql_free_result(meta_);
+				meta_ = 0;
+			}
+			cols_ = 0;
+			done_ = true;
+			// pending result sets keep the connection occupied by this result
+			if(state_->active != this)
+				return false;
+			while(mysql_more_results(conn_)) {
+				int status = mysql_stmt_next_result(stmt_);
+				if(status > 0) {
+					state_->done(this);
+					throw cppdb_myerror(mysql_stmt_error(stmt_));
+				}
+				if(status < 0)
+					break;
+				if(mysql_stmt_field_count(stmt_) == 0)
+					continue; // status of a statement inside the procedure
+				open_result_set();
+				return true;
+			}
+			state_->done(this);
+			return false;
+		}
+		virtual void drain()
+		{
+			// discards remaining rows of unbuffered result and pending result sets
+			mysql_stmt_free_result(stmt_);
+			while(mysql_more_results(conn_) && mysql_stmt_next_result(stmt_)==0)
+				mysql_stmt_free_result(stmt_);
+			done_ = true;
+			drained_ = true;
+		}
+	private:
+		static std::pmr::memory_resource *resource(backend::arena *memory)
+		{
+			return memory ? memory->resource() : std::pmr::get_default_resource();
+		}
+		void open_result_set()
+		{
+			current_row_ = 0;
+			done_ = false;
+			bind_.clear();
+			bind_data_.clear();
 			cols_ = mysql_stmt_field_count(stmt_);
-			if(mysql_stmt_store_result(stmt_)) {
+			if(!state_->stream && mysql_stmt_store_result(stmt_)) {
 				throw cppdb_myerror(mysql_stmt_error(stmt_));
 			}
 			meta_ = mysql_stmt_result_metadata(stmt_);
 			if(!meta_) {
 				throw cppdb_myerror("Seems that the query does not produce any result");
 			}
+			setup_bind();
+			if(state_->stream || mysql_more_results(conn_))
+				state_->start(this,stmt_);
+			else
+				state_->done(this);
 		}
-		~result()
-		{
-			mysql_free_result(meta_);
-		}
-		void reset()
+		//
+		// Bind the output buffers once according to the result metadata. For stored results
+		// max_length is known as STMT_ATTR_UPDATE_MAX_LENGTH is set by the statement
+		//
+		void setup_bind()
 		{
-			bind_.resize(0);
-			bind_data_.resize(0);
+			if(cols_ <= 0)
+				return;
+			MYSQL_FIELD *flds=mysql_fetch_fields(meta_);
+			if(!flds) {
+				throw cppdb_myerror("Internal error empty fileds");
+			}
 			bind_.resize(cols_,MYSQL_BIND());
 			bind_data_.resize(cols_,bind_data());
 			for(int i=0;i<cols_;i++) {
-				bind_[i].buffer_type = MYSQL_TYPE_STRING;
-				bind_[i].buffer = bind_data_[i].buf;
-				bind_[i].buffer_length = sizeof(bind_data_[i].buf);
-				bind_[i].length = &bind_data_[i].length;
-				bind_[i].is_null = &bind_data_[i].is_null;
-				bind_[i].error = &bind_data_[i].error;
-				bind_data_[i].ptr = bind_data_[i].buf;
+				bind_data &d = bind_data_[i];
+				MYSQL_BIND &b = bind_[i];
+				switch(flds[i].type) {
+				case MYSQL_TYPE_TINY:
+				case MYSQL_TYPE_SHORT:
+				case MYSQL_TYPE_INT24:
+				case MYSQL_TYPE_LONG:
+				case MYSQL_TYPE_LONGLONG:
+				case MYSQL_TYPE_YEAR:
+					d.type = MYSQL_TYPE_LONGLONG;
+					d.is_unsigned = (flds[i].flags & UNSIGNED_FLAG) != 0;
+					b.buffer = &d.int_value;
+					b.buffer_length = sizeof(d.int_value);
+					b.is_unsigned = d.is_unsigned;
+					break;
+				case MYSQL_TYPE_DOUBLE:
+					d.type = MYSQL_TYPE_DOUBLE;
+					b.buffer = &d.real_value;
+					b.buffer_length = sizeof(d.real_value);
+					break;
+				case MYSQL_TYPE_DATE:
+				case MYSQL_TYPE_NEWDATE:
+				case MYSQL_TYPE_DATETIME:
+				case MYSQL_TYPE_TIMESTAMP:
+					d.type = MYSQL_TYPE_DATETIME;
+					d.date_only = flds[i].type == MYSQL_TYPE_DATE || flds[i].type == MYSQL_TYPE_NEWDATE;
+					b.buffer = &d.time_value;
+					b.buffer_length = sizeof(d.time_value);
+					break;
+				default:
+					// text, decimal, time of day and blobs, also float to keep its
+					// textual precision
+					d.type = MYSQL_TYPE_STRING;
+					d.buf.resize(flds[i].max_length > 0 ? flds[i].max_length : default_buffer_size);
+					b.buffer = &d.buf.front();
+					b.buffer_length = d.buf.size();
+				}
+				b.buffer_type = d.type;
+				b.length = &d.length;
+				b.is_null = &d.is_null;
+				b.error = &d.error;
+			}
+			if(mysql_stmt_bind_result(stmt_,&bind_[0])) {
+				throw cppdb_myerror(mysql_stmt_error(stmt_));
 			}
 		}
-	private:
-		std::istringstream fmt_;
+		static char const *text(bind_data const &d)
+		{
+			return d.buf.empty() ? "" : &d.buf.front();
+		}
+		static sys_microseconds to_timestamp(MYSQL_TIME const &t)
+		{
+			// zero and partial dates like 0000-00-00 or 2020-00-00 are not points in time
+			if(t.month == 0 || t.day == 0)
+				throw bad_value_cast();
+			return make_timestamp(t.year,t.month,t.day,t.hour,t.minute,t.second,t.second_part);
+		}
+		static char *write_digits(char *buf,unsigned long v,int digits)
+		{
+			for(int i=digits-1;i>=0;i--) {
+				buf[i] = char('0' + v % 10);
+				v /= 10;
+			}
+			return buf + digits;
+		}
+		//
+		// Format the fields as they are, so zero and partial dates are kept as the server sent them
+		//
+		static char *format_time(char *buf,bind_data const &d)
+		{
+			MYSQL_TIME const &t = d.time_value;
+			buf = write_digits(buf,t.year,4);
+			*buf++ = '-';
+			buf = write_digits(buf,t.month,2);
+			*buf++ = '-';
+			buf = write_digits(buf,t.day,2);
+			if(d.date_only)
+				return buf;
+			*buf++ = ' ';
+			buf = write_digits(buf,t.hour,2);
+			*buf++ = ':';
+			buf = write_digits(buf,t.minute,2);
+			*buf++ = ':';
+			buf = write_digits(buf,t.second,2);
+			if(t.second_part != 0) {
+				*buf++ = '.';
+				buf = write_digits(buf,t.second_part,6);
+			}
+			return buf;
+		}
+		std::string format_number(bind_data const &d)
+		{
+			std::ostringstream ss;
+			ss.imbue(std::locale::classic());
+			if(d.type == MYSQL_TYPE_DOUBLE)
+				ss << std::setprecision(std::numeric_limits<double>::digits10+1) << d.real_value;
+			else if(d.is_unsigned)
+				ss << static_cast<unsigned long long>(d.int_value);
+			else
+				ss << d.int_value;
+			return ss.str();
+		}
+
 		int cols_;
 		MYSQL_STMT *stmt_;
+		MYSQL *conn_;
+		connection_state *state_;
 		unsigned current_row_;
 		MYSQL_RES *meta_;
-		std::vector<MYSQL_BIND> bind_;
-		std::vector<bind_data> bind_data_;
+		std::pmr::vector<MYSQL_BIND> bind_;
+		std::pmr::vector<bind_data> bind_data_;
+		bool done_;
+		bool drained_;
 	};
 
 	class statement : public backend::statement {
+		//
+		// Parameter storage, numbers and date-time values are sent in their native binary form,
+		// the storage lives as long as the statement so re-execution does not allocate
+		//
 		struct param {
 			my_bool is_null;
-			bool is_blob;
+			enum_field_types type;
+			bool is_unsigned;
 			unsigned long length;
+			int long_value;
+			long long longlong_value;
+			double double_value;
+			MYSQL_TIME time_value;
 			std::string value;
 			void *buffer;
 			param() : 
 				is_null(1),
-				is_blob(false),
+				type(MYSQL_TYPE_NULL),
+				is_unsigned(false),
 				length(0),
+				long_value(0),
+				longlong_value(0),
+				double_value(0),
 				buffer(0)
 			{
+				memset(&time_value,0,sizeof(time_value));
+			}
+			void clear()
+			{
+				is_null = 1;
+				type = MYSQL_TYPE_NULL;
+				is_unsigned = false;
+				length = 0;
+				buffer = 0;
+				value.clear();
 			}
 			void set(char const *b,char const *e,bool blob=false)
 			{
 				length = e - b;
 				buffer = const_cast<char *>(b);
-				is_blob = blob;
+				type = blob ? MYSQL_TYPE_BLOB : MYSQL_TYPE_STRING;
+				is_unsigned = false;
 				is_null = 0;
 			}
-			void set_str(std::string const &s)
+			void set_str(std::string const &s,bool blob=false)
 			{
 				value = s;
-				buffer = const_cast<char *>(value.c_str());
-				length = value.size();
-				is_null = 0;
+				set(value.c_str(),value.c_str()+value.size(),blob);
+			}
+			void set_long(int v,bool uns)
+			{
+				long_value = v;
+				set_native(MYSQL_TYPE_LONG,&long_value,sizeof(long_value),uns);
+			}
+			void set_longlong(long long v,bool uns)
+			{
+				longlong_value = v;
+				set_native(MYSQL_TYPE_LONGLONG,&longlong_value,sizeof(longlong_value),uns);
+			}
+			void set_double(double v)
+			{
+				double_value = v;
+				set_native(MYSQL_TYPE_DOUBLE,&double_value,sizeof(double_value),false);
 			}
 			void set(std::tm const &t)
 			{
-				set_str(cppdb::format_datetime(t));
+				memset(&time_value,0,sizeof(time_value));
+				time_value.year = t.tm_year + 1900;
+				time_value.month = t.tm_mon + 1;
+				time_value.day = t.tm_mday;
+				time_value.hour = t.tm_hour;
+				time_value.minute = t.tm_min;
+				time_value.second = t.tm_sec;
+				time_value.time_type = MYSQL_TIMESTAMP_DATETIME;
+				set_native(MYSQL_TYPE_DATETIME,&time_value,sizeof(time_value),false);
+			}
+			void set(sys_microseconds v)
+			{
+				long long us = v.time_since_epoch().count() % 1000000;
+				if(us < 0)
+					us += 1000000;
+				set(timestamp_to_tm(v));
+				time_value.second_part = static_cast<unsigned long>(us);
+			}
+			void set(decimal const &v)
+			{
+				char buf[datetime_buffer_size];
+				value.assign(buf,cppdb::format_decimal(buf,v));
+				set(value.c_str(),value.c_str()+value.size());
+				type = MYSQL_TYPE_NEWDECIMAL;
 			}
 			void bind_it(MYSQL_BIND *b) 
 			{
+				memset(b,0,sizeof(*b));
 				b->is_null = &is_null;
 				if(!is_null) {
-					b->buffer_type = is_blob ? MYSQL_TYPE_BLOB : MYSQL_TYPE_STRING;
+					b->buffer_type = type;
 					b->buffer = buffer;
 					b->buffer_length = length;
 					b->length = &length;
+					b->is_unsigned = is_unsigned;
 				}
 				else {
 					b->buffer_type = MYSQL_TYPE_NULL;
 				}
 			}
+		private:
+			void set_native(enum_field_types t,void *ptr,unsigned long size,bool uns)
+			{
+				type = t;
+				buffer = ptr;
+				length = size;
+				is_unsigned = uns;
+				is_null = 0;
+			}
 		};
 
 	public:
@@ -900,6 +1521,14 @@ namespace prep {
 		{
 			at(col).set(v);
 		}
+		virtual void bind(int col,sys_microseconds const &v) 
+		{
+			at(col).set(v);
+		}
+		virtual void bind(int col,decimal const &v) 
+		{
+			at(col).set(v);
+		}
 		///
 		/// Bind a BLOB value to column \a col (starting from 1).
 		///
@@ -911,17 +1540,39 @@ namespace prep {
 		{
 			std::ostringstream ss;
 			ss << v.rdbuf();
-			at(col).set_str(ss.str());
-			at(col).is_blob = true;
+			at(col).set_str(ss.str(),true);
 		}
-		template<typename T>
-		void do_bind(int col,T v)
+		void do_bind(int col,int v)
+		{
+			at(col).set_long(v,false);
+		}
+		void do_bind(int col,unsigned v)
+		{
+			at(col).set_long(static_cast<int>(v),true);
+		}
+		void do_bind(int col,long v)
+		{
+			at(col).set_longlong(v,false);
+		}
+		void do_bind(int col,unsigned long v)
+		{
+			at(col).set_longlong(static_cast<long long>(v),true);
+		}
+		void do_bind(int col,long long v)
+		{
+			at(col).set_longlong(v,false);
+		}
+		void do_bind(int col,unsigned long long v)
+		{
+			at(col).set_longlong(static_cast<long long>(v),true);
+		}
+		void do_bind(int col,double v)
 		{
-			fmt_.str(std::string());
-			if(!std::numeric_limits<T>::is_integer)
-				fmt_ << std::setprecision(std::numeric_limits<T>::digits10+1);
-			fmt_ << v;
-			at(col).set_str(fmt_.str());
+			at(col).set_double(v);
+		}
+		void do_bind(int col,long double v)
+		{
+			at(col).set_double(static_cast<double>(v));
 		}
 		///
 		/// Bind an integer value to column \a col (starting from 1).
@@ -1030,7 +1681,7 @@ namespace prep {
 		///
 		virtual void bind_null(int col)
 		{
-			at(col)=param();
+			at(col).clear();
 		}
 		///
 		/// Fetch the last sequence generated for last inserted row. May use sequence as parameter
@@ -1045,6 +1696,18 @@ namespace prep {
 		{
 			return mysql_stmt_insert_id(stmt_);
 		}
+		virtual backend::result *exec_returning(std::vector<std::string> const &columns)
+		{
+			// there is no RETURNING and only the first id of a multiple row insert is reported,
+			// the others depend on auto_increment_increment and on the rows that were ignored or updated
+			if(columns.size() != 1)
+				throw not_supported_by_backend("cppdb::mysql::exec_returning of several columns is not supported");
+			exec();
+			long long id = sequence_last(std::string());
+			if(affected() != 1 || id == 0)
+				throw not_supported_by_backend("cppdb::mysql::exec_returning is supported for a single inserted row only");
+			return generated_keys(columns[0],id,1);
+		}
 		///
 		/// Return the number of affected rows by last statement.
 		///
@@ -1072,10 +1735,12 @@ namespace prep {
 		virtual result *query() 
 		{
 			bind_all();
+			state_->release();
 			if(mysql_stmt_execute(stmt_)) {
 				throw cppdb_myerror(mysql_stmt_error(stmt_));
 			}
-			return new result(stmt_);
+			backend::arena *memory = get_arena();
+			return new(memory) result(stmt_,conn_,state_,memory);
 		}
 		///
 		/// Execute a statement, MAY throw cppdb_error if the statement returns results.
@@ -1083,6 +1748,7 @@ namespace prep {
 		virtual void exec() 
 		{
 			bind_all();
+			state_->release();
 			if(mysql_stmt_execute(stmt_)) {
 				throw cppdb_myerror(mysql_stmt_error(stmt_));
 			}
@@ -1092,29 +1758,48 @@ namespace prep {
 			MYSQL_RES *r=mysql_stmt_result_metadata(stmt_);
 			if(r) {
 				mysql_free_result(r);
+				mysql_stmt_free_result(stmt_);
+				while(mysql_more_results(conn_) && mysql_stmt_next_result(stmt_)==0)
+					mysql_stmt_free_result(stmt_);
 				throw cppdb_myerror("Calling exec() on query!");
 			}
+			// the final status of a called procedure
+			while(mysql_more_results(conn_)) {
+				int status = mysql_stmt_next_result(stmt_);
+				if(status > 0)
+					throw cppdb_myerror(mysql_stmt_error(stmt_));
+				if(status < 0)
+					break;
+				mysql_stmt_free_result(stmt_);
+			}
 		}
 		// End of API
 
 		// Caching support
 		
-		statement(std::string const &q,MYSQL *conn) :
+		statement(std::string const &q,MYSQL *conn,connection_state *state) :
 			query_(q),
 			stmt_(0),
+			conn_(conn),
+			state_(state),
 			params_count_(0)
 		{
-			fmt_.imbue(std::locale::classic());
-
 			stmt_ = mysql_stmt_init(conn);
 			try {
 				if(!stmt_) {
 					throw cppdb_myerror(" Failed to create a statement");
 				}
+				// a new command discards the remaining rows of a streamed result
+				state_->release();
 				if(mysql_stmt_prepare(stmt_,q.c_str(),q.size())) {
 					throw cppdb_myerror(mysql_stmt_error(stmt_));
 				}
 				params_count_ = mysql_stmt_param_count(stmt_);
+				// let mysql_stmt_store_result calculate the size of result buffers
+				my_bool update_max_length = 1;
+				if(mysql_stmt_attr_set(stmt_,STMT_ATTR_UPDATE_MAX_LENGTH,&update_max_length)) {
+					throw cppdb_myerror(mysql_stmt_error(stmt_));
+				}
 				reset_data();
 			}
 			catch(...) {
@@ -1129,14 +1814,21 @@ namespace prep {
 		}
 		void reset_data()
 		{
-			params_.resize(0);
+			// keep the storage, it is reused by the next execution
 			params_.resize(params_count_);
-			bind_.resize(0);
 			bind_.resize(params_count_,MYSQL_BIND());
+			for(unsigned i=0;i<params_.size();i++)
+				params_[i].clear();
 		}
 		virtual void reset()
 		{
 			reset_data();
+			if(state_->active) {
+				// the connection is busy, only discard our own unbuffered result
+				if(state_->owner != stmt_)
+					return;
+				state_->release();
+			}
 			mysql_stmt_reset(stmt_);
 		}
 
@@ -1148,11 +1840,12 @@ namespace prep {
 			return params_[col-1];
 		}
 
-		std::ostringstream fmt_;
 		std::vector<param> params_;
 		std::vector<MYSQL_BIND> bind_;
 		std::string query_;
 		MYSQL_STMT *stmt_;
+		MYSQL *conn_;
+		connection_state *state_;
 		int params_count_;
 	};
 
@@ -1193,6 +1886,12 @@ public:
 		backend::connection(ci),
 		conn_(0)
 	{
+		std::string fetch_mode = ci.get("@fetch_mode","store");
+		if(fetch_mode == "stream")
+			state_.stream = true;
+		else if(fetch_mode != "store")
+			throw cppdb_myerror("invalid @fetch_mode property, expected 'store' (default) or 'stream'");
+
 		conn_ = mysql_init(0);
 		if(!conn_) {
 			throw cppdb_error("cppdb::mysql failed to create connection");
@@ -1332,7 +2031,11 @@ public:
 			mysql_set_option(MYSQL_SHARED_MEMORY_BASE_NAME, shared_memory_base_name.c_str());
 		}
 		
-		if(!mysql_real_connect(conn_,phost,puser,ppassword,pdatabase,port,punix_socket,0)) {
+		unsigned long client_flags = CLIENT_MULTI_RESULTS;
+		if(ci.get("multi_statements",0))
+			client_flags |= CLIENT_MULTI_STATEMENTS;
+
+		if(!mysql_real_connect(conn_,phost,puser,ppassword,pdatabase,port,punix_socket,client_flags)) {
 			std::string err="unknown";
 			try { err = mysql_error(conn_); }catch(...){}
 			mysql_close(conn_);
@@ -1348,9 +2051,11 @@ public:
 	
 	void exec(std::string const &s) 
 	{
+		state_.release();
 		if(mysql_real_query(conn_,s.c_str(),s.size())) {
 			throw cppdb_myerror(mysql_error(conn_));
 		}
+		complete_query(conn_,true);
 	}
 
 	///
@@ -1386,11 +2091,11 @@ public:
 	///
 	virtual backend::statement *prepare_statement(std::string const &q)
 	{
-		return new prep::statement(q,conn_);
+		return new prep::statement(q,conn_,&state_);
 	}
 	virtual backend::statement *create_statement(std::string const &q)
 	{
-		return new unprep::statement(q,conn_);
+		return new unprep::statement(q,conn_,&state_);
 	}
 	///
 	/// Escape a string for inclusion in SQL query. May throw not_supported_by_backend() if not supported by backend.
@@ -1448,6 +2153,7 @@ private:
 		}
 	}
 	connection_info ci_;
+	connection_state state_;
 	MYSQL *conn_;
 };
 
@@ -29,6 +29,8 @@
 #include <sstream>
 #include <limits>
 #include <iomanip>
+#include <thread>
+#include <chrono>
 #include <string.h>
 
 #if defined(_WIN32) || defined(__WIN32) || defined(WIN32) || defined(__CYGWIN__)
@@ -260,82 +262,120 @@ class pool;
 
 namespace odbc_backend {
 
-std::string widen(char const *b,char const *e)
+//
+// The ASCII fast path tests 8 bytes or 4 UTF-16 units at once, the text sent to
+// and received from the databases is mostly ASCII.
+//
+static const unsigned long long ascii_mask8 = 0x8080808080808080ULL;
+static const unsigned long long ascii_mask16 = 0xFF80FF80FF80FF80ULL;
+
+//
+// Convert [b,e) from UTF-8 to UTF-16, out should have a space for e-b units,
+// returns the end of the output
+//
+odbc_u16 *utf8_to_utf16(char const *b,char const *e,odbc_u16 *out)
 {
-	std::string result;
-	result.reserve((e-b)*2);
-	odbc_u32 code_point = 0;
-	while(b < e && (code_point = utf8::next(b,e))!=utf::illegal) {
+	while(b < e) {
+		while(e - b >= 8) {
+			unsigned long long w;
+			memcpy(&w,b,8);
+			if(w & ascii_mask8)
+				break;
+			for(int i=0;i<8;i++)
+				out[i] = static_cast<unsigned char>(b[i]);
+			b+=8;
+			out+=8;
+		}
+		if(b == e)
+			break;
+		if(static_cast<unsigned char>(*b) < 0x80) {
+			*out++ = static_cast<unsigned char>(*b++);
+			continue;
+		}
+		odbc_u32 code_point = utf8::next(b,e);
+		if(code_point == utf::illegal)
+			throw cppdb_error("cppdb::odbc invalid UTF-8 input");
 		utf16::seq sq = utf16::encode(code_point);
-		char *str = (char *)sq.c;
-		result.append(str,sq.len * 2);
-	}
-	if(b!=e || code_point == utf::illegal) {
-		throw cppdb_error("cppdb::odbc invalid UTF-8 input");
+		for(unsigned i=0;i<sq.len;i++)
+			*out++ = sq.c[i];
 	}
-	return result;
+	return out;
 }
 
-std::string widen(std::string const &s)
+//
+// Convert [b,e) from UTF-16 to UTF-8, out should have a space for 3*(e-b) bytes,
+// returns the end of the output
+//
+char *utf16_to_utf8(odbc_u16 const *b,odbc_u16 const *e,char *out)
 {
-	return widen(s.c_str(),s.c_str()+s.size());
+	while(b < e) {
+		while(e - b >= 4) {
+			unsigned long long w;
+			memcpy(&w,b,8);
+			if(w & ascii_mask16)
+				break;
+			for(int i=0;i<4;i++)
+				out[i] = static_cast<char>(b[i]);
+			b+=4;
+			out+=4;
+		}
+		if(b == e)
+			break;
+		if(*b < 0x80) {
+			*out++ = static_cast<char>(*b++);
+			continue;
+		}
+		odbc_u32 code_point = utf16::next(b,e);
+		if(code_point == utf::illegal)
+			throw cppdb_error("cppdb::odbc got invalid UTF-16");
+		utf8::seq sq = utf8::encode(code_point);
+		for(unsigned i=0;i<sq.len;i++)
+			*out++ = sq.c[i];
+	}
+	return out;
 }
 
-std::string narrower(std::basic_string<SQLWCHAR> const &wide)
+//
+// Convert UTF-8 text to UTF-16 stored in the buffer out, its capacity is reused
+//
+void widen(char const *b,char const *e,std::string &out)
 {
-	odbc_u16 const *b = reinterpret_cast<odbc_u16 const *>(wide.c_str());
-	odbc_u16 const *e = b + wide.size();
-
-	std::string result;
-	result.reserve((e-b));
-
-	odbc_u32 code_point = 0;
-	while(b < e && (code_point = utf16::next(b,e))!=utf::illegal) {
-		utf8::seq sq = utf8::encode(code_point);
-		result.append(sq.c,sq.len);
-	}
-	if(b!=e || code_point == utf::illegal) {
-		throw cppdb_error("cppdb::odbc got invalid UTF-16");
-	}
-	return result;
+	out.resize((e-b)*2);
+	odbc_u16 *begin = reinterpret_cast<odbc_u16 *>(&out[0]);
+	odbc_u16 *end = utf8_to_utf16(b,e,begin);
+	out.resize((end - begin)*2);
 }
 
-std::string narrower(std::string const &wide)
+//
+// Convert UTF-16 text of given length in bytes to UTF-8 stored in the buffer out, its capacity is reused
+//
+void narrow(char const *p,size_t len,std::string &out)
 {
-	if(wide.size() % 2 != 0) {
+	if(len % 2 != 0) {
 		throw cppdb_error("cppdb::odbc got invalid UTF-16");
 	}
-	odbc_u16 const *b = reinterpret_cast<odbc_u16 const *>(wide.c_str());
-	odbc_u16 const *e = b + wide.size() / 2;
+	odbc_u16 const *b = reinterpret_cast<odbc_u16 const *>(p);
+	odbc_u16 const *e = b + len / 2;
+	out.resize((e-b)*3);
+	char *begin = &out[0];
+	char *end = utf16_to_utf8(b,e,begin);
+	out.resize(end - begin);
+}
 
+std::string narrower(std::basic_string<SQLWCHAR> const &wide)
+{
 	std::string result;
-	result.reserve((e-b));
-
-	odbc_u32 code_point = 0;
-	while(b < e && (code_point = utf16::next(b,e))!=utf::illegal) {
-		utf8::seq sq = utf8::encode(code_point);
-		result.append(sq.c,sq.len);
-	}
-	if(b!=e || code_point == utf::illegal) {
-		throw cppdb_error("cppdb::odbc got invalid UTF-16");
-	}
+	narrow(reinterpret_cast<char const *>(wide.c_str()),wide.size()*2,result);
 	return result;
 }
 
 std::basic_string<SQLWCHAR> tosqlwide(std::string const &n)
 {
 	std::basic_string<SQLWCHAR> result;
-	char const *b=n.c_str();
-	char const *e=b+n.size();
-	result.reserve(e-b);
-	odbc_u32 code_point = 0;
-	while(b < e && (code_point = utf8::next(b,e))!=utf::illegal) {
-		utf16::seq sq = utf16::encode(code_point);
-		result.append((SQLWCHAR*)sq.c,sq.len);
-	}
-	if(b!=e || code_point == utf::illegal) {
-		throw cppdb_error("cppdb::odbc invalid UTF-8 input");
-	}
+	result.resize(n.size());
+	odbc_u16 *begin = reinterpret_cast<odbc_u16 *>(&result[0]);
+	odbc_u16 *end = utf8_to_utf16(n.c_str(),n.c_str()+n.size(),begin);
+	result.resize(end - begin);
 	return result;
 }
 
@@ -404,36 +444,121 @@ void check_odbc_error(SQLRETURN error,SQLHANDLE h,SQLSMALLINT type,bool wide)
 
 
 class result : public backend::result {
+	//
+	// A column of the block cursor, short columns are bound with SQLBindCol to arrays of
+	// rows_ values, columns starting from the first long one are read with SQLGetData
+	//
+	struct column {
+		column() : 
+			ctype(SQL_C_CHAR),
+			width(0),
+			bound(false),
+			date_only(false)
+		{
+		}
+		std::string name;
+		SQLSMALLINT ctype;
+		SQLLEN width; // size of single value, 0 for long data
+		bool bound;
+		bool date_only; // SQL_C_TYPE_TIMESTAMP column of SQL_TYPE_DATE
+		std::vector<char> buf;
+		std::vector<SQLLEN> ind;
+		std::string long_value;
+	};
+	// maximal size of a column value that is bound
+	static const SQLLEN max_bound_width = 16384;
+	// maximal number of rows fetched at once and the memory they may occupy
+	static const SQLULEN max_block_rows = 64;
+	static const size_t max_block_size = 1024 * 1024;
 public:
-	typedef std::pair<bool,std::string> cell_type;
-	typedef std::vector<cell_type> row_type;
-	typedef std::list<row_type> rows_type;
 	
 	virtual next_row has_next()
 	{
-		rows_type::iterator p=current_;
-		if(p == rows_.end() || ++p==rows_.end())
+		if(done_)
 			return last_row_reached;
-		else
+		if(started_ && row_ + 1 < fetched_)
 			return next_row_exists;
+		if(started_ && fetched_ < rows_)
+			return last_row_reached; // short block is the last one
+		return next_row_unknown;
 	}
 	virtual bool next() 
 	{
-		if(started_ == false) {
-			current_ = rows_.begin();
-			started_ = true;
+		if(done_)
+			return false;
+		if(started_ && row_ + 1 < fetched_) {
+			row_++;
+			return true;
+		}
+		if(started_ && fetched_ < rows_) {
+			done_ = true;
+			return false;
 		}
-		else if(current_!=rows_.end()) {
-			++current_;
+		started_ = true;
+		row_ = 0;
+		fetched_ = 0;
+		SQLRETURN r = SQLFetch(stmt_);
+		if(r == SQL_NO_DATA) {
+			done_ = true;
+			return false;
+		}
+		check_error(r);
+		if(fetched_ == 0) {
+			done_ = true;
+			return false;
+		}
+		read_unbound();
+		return true;
+	}
+	virtual bool next_result()
+	{
+		for(;;) {
+			SQLRETURN r = SQLMoreResults(stmt_);
+			if(r == SQL_NO_DATA) {
+				columns_.clear();
+				cols_ = 0;
+				done_ = true;
+				return false;
+			}
+			check_error(r);
+			open_result_set();
+			if(cols_ > 0)
+				return true;
 		}
-		return current_!=rows_.end();
 	}
 	template<typename T>
 	bool do_fetch(int col,T &v)
 	{
-		if(at(col).first)
+		column *c;
+		char const *p;
+		size_t len;
+		if(!cell(col,c,p,len))
 			return false;
-		v=parse_number<T>(at(col).second,ss_);
+		if(c->ctype == SQL_C_SBIGINT) {
+			long long x;
+			memcpy(&x,p,sizeof(x));
+			v=numeric_cast<T>(x);
+		}
+		else if(c->ctype == SQL_C_UBIGINT) {
+			unsigned long long x;
+			memcpy(&x,p,sizeof(x));
+			v=numeric_cast<T>(x);
+		}
+		else if(c->ctype == SQL_C_DOUBLE) {
+			double x;
+			memcpy(&x,p,sizeof(x));
+			v=numeric_cast<T>(x);
+		}
+		else if(c->ctype == SQL_C_TYPE_TIMESTAMP) {
+			throw bad_value_cast();
+		}
+		else if(c->ctype == SQL_C_WCHAR) {
+			narrow(p,len,text_);
+			v=parse_number<T>(text_.c_str(),text_.c_str()+text_.size());
+		}
+		else {
+			v=parse_number<T>(p,p+len);
+		}
 		return true;
 	}
 	virtual bool fetch(int col,short &v)
@@ -482,28 +607,104 @@ public:
 	}
 	virtual bool fetch(int col,std::string &v)
 	{
-		if(at(col).first)
+		column *c;
+		char const *p;
+		size_t len;
+		if(!cell(col,c,p,len))
 			return false;
-		v=at(col).second;
+		text(*c,p,len,v);
 		return true;
 	}
 	virtual bool fetch(int col,std::ostream &v) 
 	{
-		if(at(col).first)
+		if(!fetch(col,text_))
 			return false;
-		v << at(col).second;
+		v << text_;
 		return true;
 	}
 	virtual bool fetch(int col,std::tm &v)
 	{
-		if(at(col).first)
+		column *c;
+		char const *p;
+		size_t len;
+		if(!cell(col,c,p,len))
 			return false;
-		v = parse_datetime(at(col).second);
+		if(c->ctype == SQL_C_TYPE_TIMESTAMP) {
+			v = timestamp_to_tm(to_timestamp(p));
+		}
+		else if(c->ctype == SQL_C_CHAR) {
+			v = parse_datetime(p,p+len);
+		}
+		else {
+			text(*c,p,len,text_);
+			v = parse_datetime(text_);
+		}
+		return true;
+	}
+	virtual bool fetch(int col,sys_microseconds &v)
+	{
+		column *c;
+		char const *p;
+		size_t len;
+		if(!cell(col,c,p,len))
+			return false;
+		if(c->ctype == SQL_C_TYPE_TIMESTAMP) {
+			v = to_timestamp(p);
+		}
+		else if(c->ctype == SQL_C_SBIGINT) {
+			// integer columns keep microseconds since the epoch
+			long long x;
+			memcpy(&x,p,sizeof(x));
+			v = sys_microseconds(std::chrono::microseconds(x));
+		}
+		else if(c->ctype == SQL_C_UBIGINT) {
+			unsigned long long x;
+			memcpy(&x,p,sizeof(x));
+			v = sys_microseconds(std::chrono::microseconds(numeric_cast<long long>(x)));
+		}
+		else if(c->ctype == SQL_C_CHAR) {
+			v = parse_timestamp(p,p+len);
+		}
+		else {
+			text(*c,p,len,text_);
+			v = parse_timestamp(text_);
+		}
+		return true;
+	}
+	virtual bool fetch(int col,decimal &v)
+	{
+		column *c;
+		char const *p;
+		size_t len;
+		if(!cell(col,c,p,len))
+			return false;
+		if(c->ctype == SQL_C_SBIGINT) {
+			long long x;
+			memcpy(&x,p,sizeof(x));
+			v = decimal(x);
+		}
+		else if(c->ctype == SQL_C_UBIGINT) {
+			v = decimal();
+			memcpy(&v.low,p,sizeof(v.low));
+		}
+		else if(c->ctype == SQL_C_TYPE_TIMESTAMP) {
+			throw bad_value_cast();
+		}
+		else if(c->ctype == SQL_C_CHAR) {
+			v = parse_decimal(p,p+len);
+		}
+		else {
+			text(*c,p,len,text_);
+			v = parse_decimal(text_);
+		}
 		return true;
 	}
 	virtual bool is_null(int col)
 	{
-		return at(col).first;
+		column *c;
+		char const *p;
+		size_t len;
+		return !cell(col,c,p,len);
 	}
 	virtual int cols()
 	{
@@ -511,52 +712,443 @@ public:
 	}
 	virtual int name_to_column(std::string const &cn) 
 	{
-		for(unsigned i=0;i<names_.size();i++)
-			if(names_[i]==cn)
+		for(int i=0;i<cols_;i++)
+			if(columns_[i].name==cn)
 				return i;
 		return -1;
 	}
 	virtual std::string column_to_name(int c) 
 	{
-		if(c < 0 || c >= int(names_.size()))
+		if(c < 0 || c >= cols_)
 			throw invalid_column();
-		return names_[c];
+		return columns_[c].name;
 	}
 	
-	result(rows_type &rows,std::vector<std::string> &names,int cols) : cols_(cols)
+	result(SQLHSTMT stmt,bool wide) : 
+		stmt_(stmt),
+		wide_(wide)
 	{
-		names_.swap(names);
-		rows_.swap(rows);
-		started_ = false;
-		current_ = rows_.end();
-		ss_.imbue(std::locale::classic());
+		open_result_set();
 	}
-	cell_type &at(int col)
+private:
+	void check_error(SQLRETURN code)
 	{
-		if(current_!=rows_.end() && col >= 0 && col <int(current_->size()))
-			return current_->at(col);
-		throw invalid_column();
+		check_odbc_error(code,stmt_,SQL_HANDLE_STMT,wide_);
 	}
-private:
+	static bool is_fixed(SQLSMALLINT ctype)
+	{
+		return ctype == SQL_C_SBIGINT || ctype == SQL_C_UBIGINT || ctype == SQL_C_DOUBLE || ctype == SQL_C_TYPE_TIMESTAMP;
+	}
+	static sys_microseconds to_timestamp(char const *p)
+	{
+		SQL_TIMESTAMP_STRUCT t;
+		memcpy(&t,p,sizeof(t));
+		return make_timestamp(t.year,t.month,t.day,t.hour,t.minute,t.second,t.fraction / 1000);
+	}
+	static size_t terminator(SQLSMALLINT ctype)
+	{
+		switch(ctype) {
+		case SQL_C_CHAR:
+			return 1;
+		case SQL_C_WCHAR:
+			return sizeof(SQLWCHAR);
+		default:
+			return 0;
+		}
+	}
+	//
+	// Get the value of column \a col in the current row, returns false if it is NULL
+	//
+	bool cell(int col,column *&c,char const *&p,size_t &len)
+	{
+		if(col < 0 || col >= cols_)
+			throw invalid_column();
+		if(!started_ || done_)
+			throw empty_row_access();
+		c = &columns_[col];
+		SQLLEN ind;
+		if(c->bound) {
+			ind = c->ind[row_];
+			p = &c->buf[row_ * c->width];
+		}
+		else {
+			ind = c->ind[0];
+			p = is_fixed(c->ctype) ? &c->buf[0] : c->long_value.c_str();
+		}
+		if(ind == SQL_NULL_DATA)
+			return false;
+		if(is_fixed(c->ctype)) {
+			len = c->width;
+		}
+		else {
+			if(ind < 0 || (c->bound && size_t(ind) + terminator(c->ctype) > size_t(c->width)))
+				throw cppdb_error("cppdb::odbc::query - data too long");
+			len = ind;
+		}
+		return true;
+	}
+	void text(column const &c,char const *p,size_t len,std::string &v)
+	{
+		char buf[number_buffer_size];
+		switch(c.ctype) {
+		case SQL_C_SBIGINT:
+			{
+				long long x;
+				memcpy(&x,p,sizeof(x));
+				v.assign(buf,format_number(buf,x));
+			}
+			break;
+		case SQL_C_UBIGINT:
+			{
+				unsigned long long x;
+				memcpy(&x,p,sizeof(x));
+				v.assign(buf,format_number(buf,x));
+			}
+			break;
+		case SQL_C_DOUBLE:
+			{
+				double x;
+				memcpy(&x,p,sizeof(x));
+				v.assign(buf,format_number(buf,x));
+			}
+			break;
+		case SQL_C_TYPE_TIMESTAMP:
+			{
+				char tbuf[datetime_buffer_size];
+				if(c.date_only)
+					v.assign(tbuf,format_date(tbuf,timestamp_to_tm(to_timestamp(p))));
+				else
+					v.assign(tbuf,format_timestamp(tbuf,to_timestamp(p)));
+			}
+			break;
+		case SQL_C_WCHAR:
+			narrow(p,len,v);
+			break;
+		default:
+			v.assign(p,len);
+		}
+	}
+	void describe(int col,column &c)
+	{
+		SQLSMALLINT name_length=0,data_type=0,digits=0,nullable=0;
+		SQLULEN collen = 0;
+		SQLRETURN r;
+
+		if(wide_) {
+			SQLWCHAR name[257] = {0};
+			r=SQLDescribeColW(stmt_,col+1,name,256,&name_length,&data_type,&collen,&digits,&nullable);
+			check_error(r);
+			c.name=narrower(name);
+		}
+		else {
+			SQLCHAR name[257] = {0};
+			r=SQLDescribeColA(stmt_,col+1,name,256,&name_length,&data_type,&collen,&digits,&nullable);
+			check_error(r);
+			c.name=(char*)name;
+		}
+		SQLULEN size = 0; // value size, 0 - long data
+		switch(data_type) {
+		case SQL_BIT:
+		case SQL_TINYINT:
+		case SQL_SMALLINT:
+		case SQL_INTEGER:
+			c.ctype = SQL_C_SBIGINT;
+			size = sizeof(long long);
+			break;
+		case SQL_BIGINT:
+			{
+				SQLLEN is_unsigned = SQL_FALSE;
+				r=SQLColAttribute(stmt_,col+1,SQL_DESC_UNSIGNED,0,0,0,&is_unsigned);
+				check_error(r);
+				c.ctype = is_unsigned == SQL_TRUE ? SQL_C_UBIGINT : SQL_C_SBIGINT;
+				size = sizeof(long long);
+			}
+			break;
+		case SQL_REAL:
+		case SQL_FLOAT:
+		case SQL_DOUBLE:
+			c.ctype = SQL_C_DOUBLE;
+			size = sizeof(double);
+			break;
+		case SQL_TYPE_DATE:
+		case SQL_TYPE_TIMESTAMP:
+		case SQL_TIMESTAMP:
+			c.ctype = SQL_C_TYPE_TIMESTAMP;
+			c.date_only = data_type == SQL_TYPE_DATE;
+			size = sizeof(SQL_TIMESTAMP_STRUCT);
+			break;
+		case SQL_CHAR:
+		case SQL_VARCHAR:
+			c.ctype = SQL_C_CHAR;
+			size = collen * 4 + 1; // UTF-8
+			break;
+		case SQL_WCHAR:
+		case SQL_WVARCHAR:
+			c.ctype = SQL_C_WCHAR;
+			size = (collen * 2 + 1) * sizeof(SQLWCHAR); // surrogate pairs
+			break;
+		case SQL_BINARY:
+		case SQL_VARBINARY:
+			c.ctype = SQL_C_BINARY;
+			size = collen;
+			break;
+		case SQL_LONGVARCHAR:
+			c.ctype = SQL_C_CHAR;
+			break;
+		case SQL_WLONGVARCHAR:
+			c.ctype = SQL_C_WCHAR;
+			break;
+		case SQL_LONGVARBINARY:
+			c.ctype = SQL_C_BINARY;
+			break;
+		default:
+			// decimal, time of day and other types are converted to text
+			c.ctype = SQL_C_CHAR;
+			size = collen + 3 < 64 ? 64 : collen + 3;
+		}
+		if(collen == 0 && !is_fixed(c.ctype))
+			size = 0; // unknown size
+		c.width = size <= SQLULEN(max_bound_width) ? size : 0;
+	}
+	void open_result_set()
+	{
+		SQLSMALLINT ocols = 0;
+		check_error(SQLNumResultCols(stmt_,&ocols));
+		cols_ = ocols;
+		columns_.clear();
+		columns_.resize(cols_);
+		started_ = false;
+		done_ = cols_ == 0;
+		row_ = 0;
+		fetched_ = 0;
+		rows_ = 1;
+		if(cols_ == 0)
+			return;
+
+		size_t row_size = 0;
+		int first_long = cols_;
+		for(int i=0;i<cols_;i++) {
+			describe(i,columns_[i]);
+			if(columns_[i].width == 0 && first_long == cols_)
+				first_long = i;
+			if(i < first_long)
+				row_size += columns_[i].width + sizeof(SQLLEN);
+		}
+		// SQLGetData can be used for the columns after the bound ones
+		// only if the rows are fetched one by one
+		if(first_long == cols_) {
+			rows_ = max_block_size / row_size;
+			if(rows_ > max_block_rows)
+				rows_ = max_block_rows;
+			if(rows_ < 1)
+				rows_ = 1;
+		}
+
+		SQLFreeStmt(stmt_,SQL_UNBIND);
+		check_error(SQLSetStmtAttr(stmt_,SQL_ATTR_ROW_BIND_TYPE,(SQLPOINTER)SQL_BIND_BY_COLUMN,0));
+		SQLRETURN r = SQLSetStmtAttr(stmt_,SQL_ATTR_ROW_ARRAY_SIZE,(SQLPOINTER)rows_,0);
+		if(!SQL_SUCCEEDED(r)) {
+			rows_ = 1;
+			check_error(SQLSetStmtAttr(stmt_,SQL_ATTR_ROW_ARRAY_SIZE,(SQLPOINTER)rows_,0));
+		}
+		else if(r == SQL_SUCCESS_WITH_INFO) {
+			// the driver may use a smaller block
+			SQLULEN actual = 0;
+			if(SQL_SUCCEEDED(SQLGetStmtAttr(stmt_,SQL_ATTR_ROW_ARRAY_SIZE,&actual,0,0)) && actual >= 1 && actual < rows_)
+				rows_ = actual;
+		}
+		check_error(SQLSetStmtAttr(stmt_,SQL_ATTR_ROWS_FETCHED_PTR,&fetched_,0));
+
+		for(int i=0;i<cols_;i++) {
+			column &c = columns_[i];
+			if(i < first_long) {
+				c.bound = true;
+				c.buf.resize(c.width * rows_);
+				c.ind.resize(rows_);
+				check_error(SQLBindCol(stmt_,i+1,c.ctype,&c.buf[0],c.width,&c.ind[0]));
+			}
+			else {
+				c.ind.resize(1);
+				if(is_fixed(c.ctype))
+					c.buf.resize(c.width);
+			}
+		}
+	}
+	//
+	// Read the columns that are not bound, rows are fetched one by one in this case
+	//
+	void read_unbound()
+	{
+		for(int i=0;i<cols_;i++) {
+			column &c = columns_[i];
+			if(c.bound)
+				continue;
+			if(is_fixed(c.ctype)) {
+				check_error(SQLGetData(stmt_,i+1,c.ctype,&c.buf[0],c.buf.size(),&c.ind[0]));
+				continue;
+			}
+			c.long_value.clear();
+			c.ind[0] = 0;
+			char buf[1024];
+			size_t chunk = sizeof(buf) - terminator(c.ctype);
+			for(;;) {
+				SQLLEN len = 0;
+				SQLRETURN r = SQLGetData(stmt_,i+1,c.ctype,buf,sizeof(buf),&len);
+				if(r == SQL_NO_DATA)
+					break;
+				check_error(r);
+				if(len == SQL_NULL_DATA) {
+					c.ind[0] = SQL_NULL_DATA;
+					break;
+				}
+				if(len == SQL_NO_TOTAL || size_t(len) > chunk) {
+					c.long_value.append(buf,chunk);
+					continue;
+				}
+				c.long_value.append(buf,len);
+				break;
+			}
+			if(c.ind[0] != SQL_NULL_DATA)
+				c.ind[0] = c.long_value.size();
+		}
+	}
+
+	SQLHSTMT stmt_;
+	bool wide_;
 	int cols_;
 	bool started_;
-	std::vector<std::string> names_;
-	rows_type::iterator current_;
-	rows_type rows_;
-	std::istringstream ss_;
+	bool done_;
+	std::vector<column> columns_;
+	SQLULEN rows_;
+	SQLULEN fetched_;
+	SQLULEN row_;
+	std::string text_;
 };
 
 class statements_cache;
 
 class connection;
+class statement;
+
+//
+// The state of the connection shared with its statements: statement handles kept
+// for reuse and the statement that is executed asynchronously
+//
+struct connection_state {
+	connection_state() :
+		dbc(0),
+		wide(false),
+		max_idle(16),
+		max_live(0),
+		live(0),
+		async_mode(SQL_AM_NONE),
+		async_active(0)
+	{
+	}
+	~connection_state()
+	{
+		close();
+	}
+	SQLHSTMT get_handle()
+	{
+		if(!idle.empty()) {
+			SQLHSTMT h = idle.back();
+			idle.pop_back();
+			return h;
+		}
+		if(at_limit())
+			throw cppdb_error("cppdb::odbc: the limit of statement handles (@max_handles) is reached");
+		SQLHSTMT h = 0;
+		SQLRETURN r = SQLAllocHandle(SQL_HANDLE_STMT,dbc,&h);
+		check_odbc_error(r,dbc,SQL_HANDLE_DBC,wide);
+		live++;
+		return h;
+	}
+	void put_handle(SQLHSTMT h)
+	{
+		if(idle.size() >= max_idle) {
+			free_handle(h);
+			return;
+		}
+		// return the handle to its initial state
+		SQLFreeStmt(h,SQL_CLOSE);
+		SQLFreeStmt(h,SQL_UNBIND);
+		SQLFreeStmt(h,SQL_RESET_PARAMS);
+		SQLSetStmtAttr(h,SQL_ATTR_ROW_ARRAY_SIZE,(SQLPOINTER)1,0);
+		SQLSetStmtAttr(h,SQL_ATTR_ROWS_FETCHED_PTR,0,0);
+		idle.push_back(h);
+	}
+	//
+	// Switch the asynchronous execution of the statement \a h, drivers with SQL_AM_CONNECTION
+	// support it on the connection only and it applies to all its statements
+	//
+	SQLRETURN set_async(SQLHSTMT h,bool on)
+	{
+		SQLPOINTER value = (SQLPOINTER)(on ? SQL_ASYNC_ENABLE_ON : SQL_ASYNC_ENABLE_OFF);
+		if(async_mode == SQL_AM_STATEMENT)
+			return SQLSetStmtAttr(h,SQL_ATTR_ASYNC_ENABLE,value,0);
+		return SQLSetConnectAttr(dbc,SQL_ATTR_ASYNC_ENABLE,value,0);
+	}
+	void free_handle(SQLHSTMT h)
+	{
+		SQLFreeHandle(SQL_HANDLE_STMT,h);
+		live--;
+	}
+	//
+	// No new handle can be allocated, the idle ones can still be reused
+	//
+	bool at_limit() const
+	{
+		return max_live != 0 && idle.empty() && live >= max_live;
+	}
+	void close()
+	{
+		for(unsigned i=0;i<idle.size();i++)
+			free_handle(idle[i]);
+		idle.clear();
+	}
+
+	SQLHDBC dbc;
+	bool wide;
+	size_t max_idle;
+	// limit of the allocated handles, the idle ones included, 0 for no limit
+	size_t max_live;
+	size_t live;
+	std::vector<SQLHSTMT> idle;
+	SQLUINTEGER async_mode;
+	statement *async_active;
+};
 
 class statement : public backend::statement {
+	//
+	// Parameter storage, numbers and date-time values are bound in their native binary form.
+	// The storage belongs to the statement, so the parameter is rebound only when its layout changes
+	//
 	struct parameter {
 		parameter() : 
 			null(true),
 			ctype(SQL_C_CHAR),
-			sqltype(SQL_C_NUMERIC)
+			sqltype(SQL_C_NUMERIC),
+			int_value(0),
+			real_value(0),
+			scale(0),
+			lenval(0),
+			bound(false),
+			bound_ctype(0),
+			bound_sqltype(0),
+			bound_size(0),
+			bound_scale(0),
+			bound_ptr(0),
+			bound_ind(0)
+		{
+			memset(&time_value,0,sizeof(time_value));
+		}
+		void clear()
 		{
+			null = true;
+			ctype = SQL_C_CHAR;
+			sqltype = SQL_C_NUMERIC;
+			value.clear();
 		}
 		void set_binary(char const *b,char const *e)
 		{
@@ -574,8 +1166,7 @@ class statement : public backend::statement {
 				sqltype = SQL_LONGVARCHAR;
 			}
 			else {
-				std::string tmp = widen(b,e);
-				value.swap(tmp);
+				widen(b,e,value);
 				null=false;
 				ctype=SQL_C_WCHAR;
 				sqltype = SQL_WLONGVARCHAR;
@@ -583,83 +1174,191 @@ class statement : public backend::statement {
 		}
 		void set(std::tm const &v)
 		{
-			value = cppdb::format_datetime(v);
+			time_value.year = v.tm_year + 1900;
+			time_value.month = v.tm_mon + 1;
+			time_value.day = v.tm_mday;
+			time_value.hour = v.tm_hour;
+			time_value.minute = v.tm_min;
+			time_value.second = v.tm_sec;
+			time_value.fraction = 0;
+			null=false;
+			ctype = SQL_C_TYPE_TIMESTAMP;
+			sqltype = SQL_TYPE_TIMESTAMP;
+		}
+		void set(sys_microseconds v)
+		{
+			long long us = v.time_since_epoch().count() % 1000000;
+			if(us < 0)
+				us += 1000000;
+			set(timestamp_to_tm(v));
+			time_value.fraction = static_cast<SQLUINTEGER>(us * 1000); // nanoseconds
+		}
+		void set(decimal const &v)
+		{
+			char buf[datetime_buffer_size];
+			value.assign(buf,format_decimal(buf,v));
+			scale = v.scale;
 			null=false;
-			sqltype = SQL_C_TIMESTAMP;
 			ctype = SQL_C_CHAR;
+			sqltype = SQL_DECIMAL;
+		}
+		void set_int(long long v)
+		{
+			int_value = v;
+			null=false;
+			ctype = SQL_C_SBIGINT;
+			if(std::numeric_limits<int>::min() <= v && v <= std::numeric_limits<int>::max())
+				sqltype = SQL_INTEGER;
+			else
+				sqltype = SQL_BIGINT;
+		}
+		void set_real(double v)
+		{
+			real_value = v;
+			null=false;
+			ctype = SQL_C_DOUBLE;
+			sqltype = SQL_DOUBLE;
 		}
-
 		template<typename T>
 		void set(T v)
 		{
-			std::ostringstream ss;
-			ss.imbue(std::locale::classic());
-			if(!std::numeric_limits<T>::is_integer)
-				ss << std::setprecision(std::numeric_limits<T>::digits10+1);
-			ss << v;
-
-			value=ss.str();
+			set_int(v);
+		}
+		void set(unsigned long long v)
+		{
+			if(v <= static_cast<unsigned long long>(std::numeric_limits<long long>::max())) {
+				set_int(static_cast<long long>(v));
+				return;
+			}
+			// out of range of SQL_C_SBIGINT, send as text
+			char buf[number_buffer_size];
+			value.assign(buf,format_number(buf,v));
+			scale = 0;
 			null=false;
 			ctype = SQL_C_CHAR;
-			if(std::numeric_limits<T>::is_integer) 
-				sqltype = SQL_INTEGER;
-			else
-				sqltype = SQL_DOUBLE;
-
+			sqltype = SQL_DECIMAL;
+		}
+		void set(unsigned long v)
+		{
+			set(static_cast<unsigned long long>(v));
+		}
+		void set(double v)
+		{
+			set_real(v);
+		}
+		void set(long double v)
+		{
+			set_real(static_cast<double>(v));
 		}
 		void bind(int col,SQLHSTMT stmt,bool wide)
 		{
-			int r;
+			SQLPOINTER ptr = 0;
+			SQLLEN buffer_size = 0;
+			SQLULEN column_size = 0;
+			SQLSMALLINT digits = 0;
+			SQLSMALLINT bind_ctype = ctype;
+			SQLSMALLINT bind_sqltype = sqltype;
 			if(null) {
 				lenval = SQL_NULL_DATA;
-				r = SQLBindParameter(	stmt,
-							col,
-							SQL_PARAM_INPUT,
-							SQL_C_CHAR, 
-							SQL_NUMERIC, // for null
-							10, // COLUMNSIZE
-							0, //  Presision
-							0, // string
-							0, // size
-							&lenval);
+				bind_ctype = SQL_C_CHAR;
+				bind_sqltype = SQL_NUMERIC; // for null
+				column_size = 10;
 			}
-            else {
-                lenval=value.size();
-                size_t column_size = value.size();
-                if(ctype == SQL_C_WCHAR)
-                    column_size/=2;
-                if(value.empty())
-                    column_size=1;
-                r = SQLBindParameter(	stmt,
-                            col,
-                            SQL_PARAM_INPUT,
-                            ctype,
-                            sqltype,
-                            column_size, // COLUMNSIZE
-                            0, //  Presision
-                            (void*)value.c_str(), // string
-                            value.size(),
-                            &lenval);
-            }
+			else {
+				switch(ctype) {
+				case SQL_C_SBIGINT:
+					ptr = &int_value;
+					buffer_size = lenval = sizeof(int_value);
+					column_size = sqltype == SQL_INTEGER ? 10 : 19;
+					break;
+				case SQL_C_DOUBLE:
+					ptr = &real_value;
+					buffer_size = lenval = sizeof(real_value);
+					column_size = 15;
+					break;
+				case SQL_C_TYPE_TIMESTAMP:
+					ptr = &time_value;
+					buffer_size = lenval = sizeof(time_value);
+					if(time_value.fraction != 0) {
+						column_size = 26; // yyyy-mm-dd hh:mm:ss.ffffff
+						digits = 6;
+					}
+					else {
+						column_size = 19; // yyyy-mm-dd hh:mm:ss
+					}
+					break;
+				default:
+					ptr = (void*)value.c_str();
+					buffer_size = lenval = value.size();
+					column_size = value.size();
+					if(ctype == SQL_C_WCHAR)
+						column_size/=2;
+					if(value.empty())
+						column_size=1;
+					if(sqltype == SQL_DECIMAL)
+						digits = scale;
+				}
+			}
+			if(	bound
+				&& bound_ctype == bind_ctype
+				&& bound_sqltype == bind_sqltype
+				&& bound_size == column_size
+				&& bound_scale == digits
+				&& bound_ptr == ptr
+				&& bound_ind == &lenval)
+			{
+				return; // the driver reads the same buffers on execution
+			}
+			bound = false;
+			int r = SQLBindParameter(	stmt,
+						col,
+						SQL_PARAM_INPUT,
+						bind_ctype,
+						bind_sqltype,
+						column_size, // COLUMNSIZE
+						digits, // DECIMALDIGITS
+						ptr,
+						buffer_size,
+						&lenval);
 			check_odbc_error(r,stmt,SQL_HANDLE_STMT,wide);
+			bound = true;
+			bound_ctype = bind_ctype;
+			bound_sqltype = bind_sqltype;
+			bound_size = column_size;
+			bound_scale = digits;
+			bound_ptr = ptr;
+			bound_ind = &lenval;
 		}
 
 		std::string value;
 		bool null;
 		SQLSMALLINT ctype;
 		SQLSMALLINT sqltype;
+		long long int_value;
+		double real_value;
+		SQL_TIMESTAMP_STRUCT time_value;
+		SQLSMALLINT scale;
 		SQLLEN lenval;
+
+		bool bound;
+		SQLSMALLINT bound_ctype;
+		SQLSMALLINT bound_sqltype;
+		SQLULEN bound_size;
+		SQLSMALLINT bound_scale;
+		SQLPOINTER bound_ptr;
+		SQLLEN *bound_ind;
 	};
 public:
 	// Begin of API
 	virtual void reset()
 	{
-		SQLFreeStmt(stmt_,SQL_UNBIND);
-		SQLCloseCursor(stmt_);
-		params_.resize(0);
-		if(params_no_ > 0)
-			params_.resize(params_no_);
-
+		cancel_async();
+		SQLFreeStmt(stmt_,SQL_CLOSE);
+		if(returning_stmt_)
+			SQLFreeStmt(returning_stmt_,SQL_CLOSE);
+		// keep the storage and the bindings for the next execution
+		for(unsigned i=0;i<params_.size();i++)
+			params_[i].clear();
 	}
 	parameter &param_at(int col)
 	{
@@ -695,6 +1394,14 @@ public:
 	{
 		param_at(col).set(s);
 	}
+	virtual void bind(int col,sys_microseconds const &v)
+	{
+		param_at(col).set(v);
+	}
+	virtual void bind(int col,decimal const &v)
+	{
+		param_at(col).set(v);
+	}
 	virtual void bind(int col,std::istream &in) 
 	{
 		std::ostringstream ss;
@@ -741,7 +1448,7 @@ public:
 	}
 	virtual void bind_null(int col)
 	{
-		param_at(col) = parameter();
+		param_at(col).clear();
 	}
 	void bind_all()
 	{
@@ -759,177 +1466,99 @@ public:
 	}
 	virtual result *query()
 	{
-		bind_all();
-		int r = real_exec();
-		check_error(r);
-		result::rows_type rows;
-		result::row_type row;
-		
-		std::string value;
-		bool is_null = false;
-		SQLSMALLINT ocols;
-		r = SQLNumResultCols(stmt_,&ocols);
+		SQLRETURN r = async_ != async_none ? wait_async() : execute();
 		check_error(r);
-		int cols = ocols;
-
-		std::vector<std::string> names(cols);
-		std::vector<int> types(cols,SQL_C_CHAR);
-
-		for(int col=0;col < cols;col++) {
-			SQLSMALLINT name_length=0,data_type=0,digits=0,nullable=0;
-			SQLULEN collen = 0;
-
-			if(wide_) {
-				SQLWCHAR name[257] = {0};
-				r=SQLDescribeColW(stmt_,col+1,name,256,&name_length,&data_type,&collen,&digits,&nullable);
-				check_error(r);
-				names[col]=narrower(name);
-			}
-			else {
-				SQLCHAR name[257] = {0};
-				r=SQLDescribeColA(stmt_,col+1,name,256,&name_length,&data_type,&collen,&digits,&nullable);
-				check_error(r);
-				names[col]=(char*)name;
-			}
-			switch(data_type) {
-			case SQL_CHAR:
-			case SQL_VARCHAR:
-			case SQL_LONGVARCHAR:
-				types[col]=SQL_C_CHAR;
-				break;
-			case SQL_WCHAR:
-			case SQL_WVARCHAR:
-			case SQL_WLONGVARCHAR:
-				types[col]=SQL_C_WCHAR ;
-				break;
-			case SQL_BINARY:
-			case SQL_VARBINARY:
-			case SQL_LONGVARBINARY:
-				types[col]=SQL_C_BINARY ;
-				break;
-			default:
-				types[col]=SQL_C_DEFAULT;
-				// Just a hack, actually I'm going to use C
-				;
-			}
-		}
-
-		while((r=SQLFetch(stmt_))==SQL_SUCCESS || r==SQL_SUCCESS_WITH_INFO) {
-			row.resize(cols);
-			for(int col=0;col < cols;col++) {
-				SQLLEN len = 0;
-				is_null=false;
-				int type = types[col];
-				if(type==SQL_C_DEFAULT) {
-					char buf[64];
-					int r = SQLGetData(stmt_,col+1,SQL_C_CHAR,buf,sizeof(buf),&len);
-					check_error(r);
-					if(len == SQL_NULL_DATA) {
-						is_null = true;
-					}
-					else if(len <= 64) {
-						value.assign(buf,len);
-					}
-					else {
-						throw cppdb_error("cppdb::odbc::query - data too long");
-					}
-				}
-				else {
-					char buf[1024];
-					size_t real_len;
-					if(type == SQL_C_CHAR) {
-						real_len = sizeof(buf)-1;
-					}
-					else if(type == SQL_C_BINARY) {
-						real_len = sizeof(buf);
-					}
-					else { // SQL_C_WCHAR
-						real_len = sizeof(buf) - sizeof(SQLWCHAR);
-					}
-
-					r = SQLGetData(stmt_,col+1,type,buf,sizeof(buf),&len);
-					check_error(r);
-					if(len == SQL_NULL_DATA) {
-						is_null = true;	
-					}
-					else if(len == SQL_NO_TOTAL) {
-						while(len==SQL_NO_TOTAL) {
-							value.append(buf,real_len);
-							r = SQLGetData(stmt_,col+1,type,buf,sizeof(buf),&len);
-							check_error(r);
-						}
-						value.append(buf,len);
-					}
-					else if(0<= len && size_t(len) <= real_len) {
-						value.assign(buf,len);
-					}
-					else if(len>=0) {
-						value.assign(buf,real_len);
-						size_t rem_len = len - real_len;
-						std::vector<char> tmp(rem_len+2,0);
-						r = SQLGetData(stmt_,col+1,type,&tmp[0],tmp.size(),&len);
-						check_error(r);
-						value.append(&tmp[0],rem_len);
-					}
-					else {
-						throw cppdb_error("cppdb::odbc::query invalid result length");
-					}
-					if(!is_null && type == SQL_C_WCHAR) {
-						std::string tmp=narrower(value);
-						value.swap(tmp);
-					}
-				}
-					
-				row[col].first = is_null;
-				row[col].second.swap(value);
-			}
-			rows.push_back(result::row_type());
-			rows.back().swap(row);
-		}
-		if(r!=SQL_NO_DATA) {
+		return new(get_arena()) result(stmt_,wide_);
+	}
+	virtual void exec()
+	{
+		SQLRETURN r = async_ != async_none ? wait_async() : execute();
+		if(r!=SQL_NO_DATA)
 			check_error(r);
-		}
-		return new result(rows,names,cols);
 	}
-
-	int real_exec()
+	virtual backend::result *exec_returning(std::vector<std::string> const &columns)
 	{
-		int r = 0;
-		if(prepared_) {
-			r=SQLExecute(stmt_);
+		std::string const &q = returning_query(columns);
+		if(q.empty())
+			return backend::statement::exec_returning(columns);
+		cancel_async();
+		finish_other_async();
+		if(!returning_stmt_)
+			returning_stmt_ = state_->get_handle();
+		else
+			SQLFreeStmt(returning_stmt_,SQL_CLOSE);
+		// the values are bound to the rewritten statement for this execution only
+		for(unsigned i=0;i<params_.size();i++) {
+			params_[i].bound = false;
+			params_[i].bind(i+1,returning_stmt_,wide_);
+			params_[i].bound = false;
+		}
+		SQLRETURN r;
+		if(wide_) {
+			std::basic_string<SQLWCHAR> wq = tosqlwide(q);
+			r = SQLExecDirectW(returning_stmt_,(SQLWCHAR*)wq.c_str(),SQL_NTS);
 		}
 		else {
-			if(wide_)
-				r=SQLExecDirectW(stmt_,(SQLWCHAR*)tosqlwide(query_).c_str(),SQL_NTS);
-			else
-				r=SQLExecDirectA(stmt_,(SQLCHAR*)query_.c_str(),SQL_NTS);
+			r = SQLExecDirectA(returning_stmt_,(SQLCHAR*)q.c_str(),SQL_NTS);
 		}
-		return r;
+		check_odbc_error(r,returning_stmt_,SQL_HANDLE_STMT,wide_);
+		return new(get_arena()) result(returning_stmt_,wide_);
 	}
-	virtual void exec()
+	virtual bool start_async()
 	{
+		if(state_->async_mode == SQL_AM_NONE)
+			return false;
+		finish_other_async();
+		if(async_ != async_none)
+			wait_async();
 		bind_all();
-		int r=real_exec();
-		if(r!=SQL_NO_DATA)
-			check_error(r);
+		// on the connection level it fails if another statement has pending results,
+		// the statement is executed synchronously then
+		if(!SQL_SUCCEEDED(state_->set_async(stmt_,true)))
+			return false;
+		async_ = async_running;
+		state_->async_active = this;
+		SQLRETURN r = real_exec();
+		if(r != SQL_STILL_EXECUTING)
+			complete_async(r);
+		return true;
+	}
+	virtual bool poll_async()
+	{
+		if(async_ != async_running)
+			return true;
+		// the asynchronous function is polled by calling it once again
+		SQLRETURN r = real_exec();
+		if(r == SQL_STILL_EXECUTING)
+			return false;
+		complete_async(r);
+		return true;
 	}
 	// End of API
 
-	statement(std::string const &q,SQLHDBC dbc,bool wide,bool prepared) :
-		dbc_(dbc),
-		wide_(wide),
+	statement(std::string const &q,connection_state *state,bool prepared) :
+		dbc_(state->dbc),
+		stmt_(0),
+		returning_stmt_(0),
+		wide_(state->wide),
 		query_(q),
 		params_no_(-1),
+		state_(state),
+		async_(async_none),
+		async_status_(SQL_SUCCESS),
 		prepared_(prepared)
 	{
-		SQLRETURN r = SQLAllocHandle(SQL_HANDLE_STMT,dbc,&stmt_);
-		check_odbc_error(r,dbc,SQL_HANDLE_DBC,wide_);
+		if(wide_)
+			wquery_ = tosqlwide(query_);
+		stmt_ = state_->get_handle();
 		if(prepared_) {
+			finish_other_async();
+			SQLRETURN r;
 			try {
 				if(wide_) {
 					r = SQLPrepareW(
 						stmt_,
-						(SQLWCHAR*)tosqlwide(query_).c_str(),
+						(SQLWCHAR*)wquery_.c_str(),
 						SQL_NTS);
 				}
 				else {
@@ -941,7 +1570,7 @@ public:
 				check_error(r);
 			}
 			catch(...) {
-				SQLFreeHandle(SQL_HANDLE_STMT,stmt_);
+				state_->free_handle(stmt_);
 				throw;
 			}
 			SQLSMALLINT params_no;
@@ -956,21 +1585,118 @@ public:
 	}
 	~statement()
 	{
-		SQLFreeHandle(SQL_HANDLE_STMT,stmt_);
+		if(returning_stmt_)
+			state_->put_handle(returning_stmt_);
+		if(async_ == async_running) {
+			cancel_async();
+			state_->free_handle(stmt_);
+		}
+		else {
+			state_->put_handle(stmt_);
+		}
 	}
 private:
+	enum async_state {
+		async_none,	// no asynchronous execution
+		async_running,	// executed by the driver
+		async_completed	// completed, waiting for query() or exec()
+	};
 	void check_error(int code)
 	{
 		check_odbc_error(code,stmt_,SQL_HANDLE_STMT,wide_);
 	}
+	SQLRETURN execute()
+	{
+		finish_other_async();
+		bind_all();
+		return real_exec();
+	}
+	SQLRETURN real_exec()
+	{
+		SQLRETURN r = 0;
+		if(prepared_) {
+			r=SQLExecute(stmt_);
+		}
+		else {
+			if(wide_)
+				r=SQLExecDirectW(stmt_,(SQLWCHAR*)wquery_.c_str(),SQL_NTS);
+			else
+				r=SQLExecDirectA(stmt_,(SQLCHAR*)query_.c_str(),SQL_NTS);
+		}
+		return r;
+	}
+	void complete_async(SQLRETURN r)
+	{
+		async_ = async_completed;
+		async_status_ = r;
+		async_error_.clear();
+		if(r != SQL_NO_DATA && !SQL_SUCCEEDED(r)) {
+			// keep the error, the diagnostics are cleared by the following calls
+			try {
+				check_error(r);
+			}
+			catch(cppdb_error const &e) {
+				async_error_ = e.what();
+			}
+		}
+		if(state_->async_active == this)
+			state_->async_active = 0;
+		state_->set_async(stmt_,false);
+	}
+	//
+	// Wait for the completion of the asynchronous execution, its status is kept for query() or exec()
+	//
+	void finish_async()
+	{
+		while(!poll_async())
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	//
+	// Only one statement of the connection runs asynchronously and with SQL_AM_CONNECTION
+	// the calls on any other statement would be asynchronous as well, so it is completed first
+	//
+	void finish_other_async()
+	{
+		if(state_->async_active && state_->async_active != this)
+			state_->async_active->finish_async();
+	}
+	//
+	// Wait for the completion of the asynchronous execution and return its status
+	//
+	SQLRETURN wait_async()
+	{
+		finish_async();
+		async_ = async_none;
+		if(!async_error_.empty())
+			throw cppdb_error(async_error_);
+		return async_status_;
+	}
+	void cancel_async()
+	{
+		if(async_ == async_running) {
+			SQLCancel(stmt_);
+			SQLRETURN r;
+			while((r = real_exec()) == SQL_STILL_EXECUTING)
+				std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			complete_async(r);
+		}
+		async_ = async_none;
+	}
 
 
 	SQLHDBC dbc_;
 	SQLHSTMT stmt_;
+	// executes the query rewritten by exec_returning()
+	SQLHSTMT returning_stmt_;
 	bool wide_;
 	std::string query_;
+	std::basic_string<SQLWCHAR> wquery_;
 	std::vector<parameter> params_;
 	int params_no_;
+	connection_state *state_;
+	async_state async_;
+	SQLRETURN async_status_;
+	std::string async_error_;
 
 	friend class connection;
 	bool prepared_;
@@ -1033,10 +1759,20 @@ public:
 				SQLFreeHandle(SQL_HANDLE_ENV,env_);
 			throw;
 		}
+		state_.dbc = dbc_;
+		state_.wide = wide_;
+		state_.max_idle = ci.get("@handle_pool_size",16);
+		state_.max_live = ci.get("@max_handles",0);
+		SQLUINTEGER async_mode = SQL_AM_NONE;
+		if(SQL_SUCCEEDED(SQLGetInfo(dbc_,SQL_ASYNC_MODE,&async_mode,sizeof(async_mode),0)))
+			state_.async_mode = async_mode;
 	}
 
 	~connection()
 	{
+		// statements return their handles to the state that must be released before disconnecting
+		clear_cache();
+		state_.close();
 		SQLDisconnect(dbc_);
 		SQLFreeHandle(SQL_HANDLE_DBC,dbc_);
 		SQLFreeHandle(SQL_HANDLE_ENV,env_);
@@ -1049,6 +1785,7 @@ public:
 	}
 	virtual void commit()
 	{
+		finish_async();
 		SQLRETURN r = SQLEndTran(SQL_HANDLE_DBC,dbc_,SQL_COMMIT);
 		check_odbc_error(r,dbc_,SQL_HANDLE_DBC,wide_);
 		set_autocommit(true);
@@ -1057,6 +1794,7 @@ public:
 	virtual void rollback() 
 	{
 		try {
+			finish_async();
 			SQLRETURN r = SQLEndTran(SQL_HANDLE_DBC,dbc_,SQL_ROLLBACK);
 			check_odbc_error(r,dbc_,SQL_HANDLE_DBC,wide_);
 		}catch(...) {}
@@ -1068,9 +1806,18 @@ public:
 	{
 			std::string eng=engine();
 			if(eng == "postgresql") prepared = true;
-		std::unique_ptr<statement> st(new statement(q,dbc_,wide_,prepared));
+		// the cached statements hold their handles, release them to stay within @max_handles
+		if(state_.at_limit())
+			clear_cache();
+		std::unique_ptr<statement> st(new statement(q,&state_,prepared));
 		return st.release();		
 	}
+	virtual bool poll_async()
+	{
+		if(!state_.async_active)
+			return true;
+		return state_.async_active->poll_async();
+	}
 
 	virtual statement *prepare_statement(std::string const &q)
 	{
@@ -1104,8 +1851,17 @@ public:
 		return ci_.get("@engine","unknown");
 	}
 
+	//
+	// Complete the asynchronous execution of a statement before a call on the connection
+	//
+	void finish_async()
+	{
+		if(state_.async_active)
+			state_.async_active->finish_async();
+	}
 	void set_autocommit(bool on)
 	{
+		finish_async();
 		SQLPOINTER mode = (SQLPOINTER)(on ? SQL_AUTOCOMMIT_ON : SQL_AUTOCOMMIT_OFF);
 		SQLRETURN r = SQLSetConnectAttr(
 					dbc_, // handler
@@ -1136,6 +1892,7 @@ private:
 	SQLHDBC dbc_;
 	bool wide_;
 	connection_info ci_;
+	connection_state state_;
 };
 
 
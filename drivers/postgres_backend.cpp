@@ -29,6 +29,7 @@
 #include <vector>
 #include <limits>
 #include <iomanip>
+#include <algorithm>
 #include <stdlib.h>
 #include <string.h>
 
@@ -44,6 +45,67 @@ namespace cppdb {
 
 		std::string default_blob("lo");
 
+		// the parameters sent in the binary form by the unprepared statements
+		enum {
+			binary_timestamp = 1,	// needs integer_datetimes
+			binary_numeric = 2
+		};
+		static const Oid numeric_oid = 1700;
+		// a time point is sent as timestamptz, so a timestamptz column does not depend on the
+		// time zone of the session
+		static const Oid timestamptz_oid = 1184;
+
+		//
+		// Append the \a size lower bytes of \a v to \a out in the network order
+		//
+		static void put_be(std::string &out,unsigned long long v,int size)
+		{
+			for(int i=size-1;i>=0;i--)
+				out += char((v >> (i*8)) & 0xFF);
+		}
+		//
+		// Encode the decimal text [b,e) with \a scale digits after the point in the binary
+		// numeric format: ndigits, weight, sign, dscale and the base 10000 digits
+		//
+		static void encode_numeric(std::string &out,char const *b,char const *e,int scale)
+		{
+			bool negative = b!=e && *b=='-';
+			if(negative)
+				b++;
+			char const *point = std::find(b,e,'.');
+			std::string digits(b,point);
+			size_t leading = digits.find_first_not_of('0');
+			digits.erase(0,leading == std::string::npos ? digits.size() : leading);
+			int int_groups = int(digits.size() + 3) / 4;
+			digits.insert(0,int_groups * 4 - digits.size(),'0');
+			if(point != e)
+				digits.append(point + 1,e);
+			digits.append((4 - digits.size() % 4) % 4,'0');
+			std::vector<int> groups;
+			for(size_t i=0;i<digits.size();i+=4)
+				groups.push_back(atoi(digits.substr(i,4).c_str()));
+			int weight = int_groups - 1;
+			size_t first = 0;
+			while(first < groups.size() && groups[first] == 0) {
+				first++;
+				weight--;
+			}
+			size_t last = groups.size();
+			while(last > first && groups[last-1] == 0)
+				last--;
+			if(first == last) {
+				weight = 0;
+				negative = false;
+			}
+			out.clear();
+			put_be(out,last - first,2);
+			put_be(out,static_cast<unsigned short>(weight),2);
+			put_be(out,negative ? 0x4000 : 0,2);
+			put_be(out,scale,2);
+			for(size_t i=first;i<last;i++)
+				put_be(out,groups[i],2);
+		}
+
 		class pqerror : public cppdb_error {
 		public:
 			pqerror(char const *msg) : cppdb_error(message(msg)) {}
@@ -82,7 +144,6 @@ namespace cppdb {
 				current_(-1),
 				blob_(b)
 			{
-				ss_.imbue(std::locale::classic());
 			}
 			virtual ~result() 
 			{
@@ -110,8 +171,8 @@ namespace cppdb {
 			{
 				if(do_isnull(col))
 					return false;
-				std::string tmp(PQgetvalue(res_,current_,col),PQgetlength(res_,current_,col));
-				v=parse_number<T>(tmp,ss_);
+				char const *s = PQgetvalue(res_,current_,col);
+				v=parse_number<T>(s,s + PQgetlength(res_,current_,col));
 				return true;
 			}
 			virtual bool fetch(int col,short &v)
@@ -224,7 +285,34 @@ namespace cppdb {
 			{
 				if(do_isnull(col))
 					return false;
-				v=parse_datetime(PQgetvalue(res_,current_,col));
+				char const *s = PQgetvalue(res_,current_,col);
+				v=parse_datetime(s,s + PQgetlength(res_,current_,col));
+				return true;
+			}
+			virtual bool fetch(int col,sys_microseconds &v)
+			{
+				if(do_isnull(col))
+					return false;
+				char const *s = PQgetvalue(res_,current_,col);
+				char const *e = s + PQgetlength(res_,current_,col);
+				switch(PQftype(res_,col)) {
+				case 20: // int8
+				case 23: // int4
+				case 21: // int2
+					// integer columns keep microseconds since the epoch
+					v=sys_microseconds(std::chrono::microseconds(parse_number<long long>(s,e)));
+					break;
+				default:
+					v=parse_timestamp(s,e);
+				}
+				return true;
+			}
+			virtual bool fetch(int col,decimal &v)
+			{
+				if(do_isnull(col))
+					return false;
+				char const *s = PQgetvalue(res_,current_,col);
+				v=parse_decimal(s,s + PQgetlength(res_,current_,col));
 				return true;
 			}
 			virtual bool is_null(int col)
@@ -264,7 +352,6 @@ namespace cppdb {
 			int cols_;
 			int current_;
 			blob_type blob_;
-			std::istringstream ss_;
 		};
 
 		class statement : public backend::statement {
@@ -273,37 +360,26 @@ namespace cppdb {
 			typedef enum {
 				null_param,
 				text_param,
-				binary_param
+				binary_param,
+				timestamp_param,	// binary timestamp, int8 microseconds since 2000-01-01
+				numeric_param		// binary numeric, base 10000 digits
 			} param_type;
 
-			statement(PGconn *conn,std::string const &src_query,blob_type b,unsigned long long prepared_id) :
+			statement(PGconn *conn,statement **async_active,std::string const &src_query,blob_type b,unsigned long long prepared_id,int binary_params) :
 				res_(0),
 				conn_(conn),
+				async_active_(async_active),
+				async_(async_none),
 				orig_query_(src_query),
 				params_(0),
-				blob_(b)
+				blob_(b),
+				// the types of the parameters of a prepared statement are deduced by the server,
+				// only the unprepared ones are sent with their types
+				binary_params_(prepared_id > 0 ? 0 : binary_params)
 			{
 				fmt_.imbue(std::locale::classic());
 
-				query_.reserve(src_query.size());
-				bool inside_string=false;
-				for(unsigned i=0;i<src_query.size();i++) {
-					char c=src_query[i];
-					if(c=='\'') {
-						inside_string = !inside_string;
-					}
-					if(!inside_string && c=='?') {
-						query_+='$';
-						params_++;
-						fmt_<<params_;
-						query_+=fmt_.str();
-						fmt_.str(std::string());
-						fmt_.clear();
-					}
-					else {
-						query_+=c;
-					}
-				}
+				query_ = number_placeholders(src_query,params_);
 				reset();
 
 				if(prepared_id > 0) {
@@ -315,6 +391,7 @@ namespace cppdb {
 					fmt_.str(std::string());
 					fmt_.clear();
 
+					finish_other_async();
 					PGresult *r=PQprepare(conn_,prepared_id_.c_str(),query_.c_str(),0,0);
 					try {
 						if(!r) {
@@ -333,11 +410,13 @@ namespace cppdb {
 			virtual ~statement()
 			{
 				try {
+					finish_async();
 					if(res_) {
 						PQclear(res_);
 						res_ = 0;
 					}
 					if(!prepared_id_.empty()) {
+						finish_other_async();
 						std::string stmt = "DEALLOCATE " + prepared_id_;
 						res_ = PQexec(conn_,stmt.c_str());
 						if(res_)  {
@@ -352,18 +431,28 @@ namespace cppdb {
 			}
 			virtual void reset()
 			{
+				finish_async();
+				async_ = async_none;
+				async_error_.clear();
 				if(res_) {
 					PQclear(res_);
 					res_ = 0;
 				}
-				std::vector<std::string> vals(params_);
-				std::vector<size_t> lengths(params_,0);
-				std::vector<char const *> pvals(params_,0);
-				std::vector<param_type> flags(params_,null_param);
-				params_values_.swap(vals);
-				params_pvalues_.swap(pvals);
-				params_plengths_.swap(lengths);
-				params_set_.swap(flags);
+				// keep the storage for the next execution, only the bound parameters are cleared
+				if(params_set_.size() != params_) {
+					params_values_.resize(params_);
+					params_pvalues_.resize(params_,0);
+					params_plengths_.resize(params_,0);
+					params_set_.resize(params_,null_param);
+				}
+				for(unsigned i=0;i<params_;i++) {
+					if(params_set_[i] == null_param)
+						continue;
+					params_values_[i].clear();
+					params_pvalues_[i] = 0;
+					params_plengths_[i] = 0;
+					params_set_[i] = null_param;
+				}
 			}
 			virtual void bind(int col,std::string const &v)
 			{
@@ -383,7 +472,46 @@ namespace cppdb {
 			virtual void bind(int col,std::tm const &v) 
 			{
 				check(col);
-				params_values_[col-1]=cppdb::format_datetime(v);
+				char buf[datetime_buffer_size];
+				params_values_[col-1].assign(buf,cppdb::format_datetime(buf,v));
+				params_pvalues_[col-1] = 0;
+				params_set_[col-1]=text_param;
+			}
+			virtual void bind(int col,sys_microseconds const &v) 
+			{
+				check(col);
+				if(binary_params_ & binary_timestamp) {
+					// microseconds since 2000-01-01 00:00:00 UTC
+					long long us = v.time_since_epoch().count() - 946684800000000LL;
+					params_values_[col-1].clear();
+					put_be(params_values_[col-1],static_cast<unsigned long long>(us),8);
+					params_pvalues_[col-1] = 0;
+					params_set_[col-1]=timestamp_param;
+					return;
+				}
+				char buf[datetime_buffer_size];
+				char *end = cppdb::format_timestamp(buf,v);
+				// the text is UTC, without the offset a timestamptz is read in the session time zone
+				*end++='+';
+				*end++='0';
+				*end++='0';
+				params_values_[col-1].assign(buf,end);
+				params_pvalues_[col-1] = 0;
+				params_set_[col-1]=text_param;
+			}
+			virtual void bind(int col,decimal const &v) 
+			{
+				check(col);
+				char buf[datetime_buffer_size];
+				char *end = cppdb::format_decimal(buf,v);
+				if(binary_params_ & binary_numeric) {
+					encode_numeric(params_values_[col-1],buf,end,v.scale);
+					params_pvalues_[col-1] = 0;
+					params_set_[col-1]=numeric_param;
+					return;
+				}
+				params_values_[col-1].assign(buf,end);
+				params_pvalues_[col-1] = 0;
 				params_set_[col-1]=text_param;
 			}
 			virtual void bind(int col,std::istream &in)
@@ -393,11 +521,13 @@ namespace cppdb {
 					std::ostringstream ss;
 					ss << in.rdbuf();
 					params_values_[col-1]=ss.str();
+					params_pvalues_[col-1] = 0;
 					params_set_[col-1]=binary_param;
 				}
 				else {
 					Oid id = 0;
 					int fd = -1;
+					finish_other_async();
 					try {
 						id = lo_creat(conn_, INV_READ|INV_WRITE);
 						if(id == 0)
@@ -438,15 +568,10 @@ namespace cppdb {
 			void do_bind(int col,T v)
 			{
 				check(col);
-				fmt_.str(std::string());
-				fmt_.clear();
-				if(!std::numeric_limits<T>::is_integer)
-					fmt_ << std::setprecision(std::numeric_limits<T>::digits10+1);
-				fmt_ << v;
-				params_values_[col-1]=fmt_.str();
+				char buf[number_buffer_size];
+				params_values_[col-1].assign(buf,format_number(buf,v));
+				params_pvalues_[col-1] = 0;
 				params_set_[col-1]=text_param;
-				fmt_.str(std::string());
-				fmt_.clear();
 			}
 
 			virtual void bind(int col,int v)
@@ -485,41 +610,55 @@ namespace cppdb {
 			{
 				check(col);
 				params_set_[col-1]=null_param;
-				std::string tmp;
-				params_values_[col-1].swap(tmp);
+				params_values_[col-1].clear();
+				params_pvalues_[col-1] = 0;
 			}
 
-			void real_query()
-			{
-				char const * const *pvalues = 0;
-				int *plengths = 0;
-				int *pformats = 0;
-				std::vector<char const *> values;
-				std::vector<int> lengths;
-				std::vector<int> formats;
-				if(params_>0) {
-					values.resize(params_,0);
-					lengths.resize(params_,0);
-					formats.resize(params_,0);
-					for(unsigned i=0;i<params_;i++) {
-						if(params_set_[i]!=null_param) {
-							if(params_pvalues_[i]!=0) {
-								values[i]=params_pvalues_[i];
-								lengths[i]=params_plengths_[i];
-							}
-							else {
-								values[i]=params_values_[i].c_str();
-								lengths[i]=params_values_[i].size();
-							}
-							if(params_set_[i]==binary_param) {
-								formats[i]=1;
-							}
+			void setup_params()
+			{
+				if(params_==0)
+					return;
+				values_.assign(params_,0);
+				lengths_.assign(params_,0);
+				formats_.assign(params_,0);
+				types_.assign(params_,0);
+				for(unsigned i=0;i<params_;i++) {
+					if(params_set_[i]!=null_param) {
+						if(params_pvalues_[i]!=0) {
+							values_[i]=params_pvalues_[i];
+							lengths_[i]=params_plengths_[i];
+						}
+						else {
+							values_[i]=params_values_[i].c_str();
+							lengths_[i]=params_values_[i].size();
+						}
+						switch(params_set_[i]) {
+						case binary_param:
+							formats_[i]=1;
+							break;
+						case timestamp_param:
+							formats_[i]=1;
+							types_[i]=timestamptz_oid;
+							break;
+						case numeric_param:
+							formats_[i]=1;
+							types_[i]=numeric_oid;
+							break;
+						default:
+							break;
 						}
 					}
-					pvalues=&values.front();
-					plengths=&lengths.front();
-					pformats=&formats.front();
 				}
+			}
+			Oid const *ptypes() { return params_ > 0 ? &types_.front() : 0; }
+			char const * const *pvalues() { return params_ > 0 ? &values_.front() : 0; }
+			int const *plengths() { return params_ > 0 ? &lengths_.front() : 0; }
+			int const *pformats() { return params_ > 0 ? &formats_.front() : 0; }
+
+			void real_query()
+			{
+				finish_other_async();
+				setup_params();
 				if(res_) {
 					PQclear(res_);
 					res_ = 0;
@@ -529,10 +668,10 @@ namespace cppdb {
 						conn_,
 						query_.c_str(),
 						params_,
-						0, // param types
-						pvalues,
-						plengths,
-						pformats, // format - text
+						ptypes(),
+						pvalues(),
+						plengths(),
+						pformats(), // format - text
 						0 // result format - text
 						);
 				}
@@ -541,21 +680,136 @@ namespace cppdb {
 						conn_,
 						prepared_id_.c_str(),
 						params_,
-						pvalues,
-						plengths,
-						pformats, // format - text
+						pvalues(),
+						plengths(),
+						pformats(), // format - text
+						0 // result format - text
+						);
+				}
+			}
+			void execute()
+			{
+				if(async_ != async_none)
+					wait_async();
+				else
+					real_query();
+			}
+
+			virtual bool start_async()
+			{
+				finish_other_async();
+				if(async_ != async_none)
+					wait_async();
+				setup_params();
+				if(res_) {
+					PQclear(res_);
+					res_ = 0;
+				}
+				int ok;
+				if(prepared_id_.empty()) {
+					ok = PQsendQueryParams(
+						conn_,
+						query_.c_str(),
+						params_,
+						ptypes(),
+						pvalues(),
+						plengths(),
+						pformats(),
+						0 // result format - text
+						);
+				}
+				else {
+					ok = PQsendQueryPrepared(
+						conn_,
+						prepared_id_.c_str(),
+						params_,
+						pvalues(),
+						plengths(),
+						pformats(),
 						0 // result format - text
 						);
 				}
+				if(!ok)
+					throw pqerror(conn_,"failed to send query");
+				async_ = async_running;
+				async_error_.clear();
+				*async_active_ = this;
+				return true;
+			}
+			virtual bool poll_async()
+			{
+				if(async_ != async_running)
+					return true;
+				if(!PQconsumeInput(conn_)) {
+					async_error_ = pqerror::message("failed to read query result",conn_);
+					complete_async();
+					return true;
+				}
+				while(!PQisBusy(conn_)) {
+					PGresult *r = PQgetResult(conn_);
+					if(!r) {
+						complete_async();
+						return true;
+					}
+					keep_result(r);
+				}
+				return false;
+			}
+			//
+			// Wait for all the results of the query sent by start_async()
+			//
+			void finish_async()
+			{
+				if(async_ != async_running)
+					return;
+				PGresult *r;
+				while((r=PQgetResult(conn_))!=0)
+					keep_result(r);
+				complete_async();
+			}
+
+			virtual backend::result *exec_returning(std::vector<std::string> const &columns)
+			{
+				std::string const &q = returning_query(columns);
+				if(q.empty())
+					return backend::statement::exec_returning(columns);
+				if(returning_src_ != q) {
+					unsigned params = 0;
+					returning_query_ = number_placeholders(q,params);
+					returning_src_ = q;
+				}
+				finish_other_async();
+				finish_async();
+				async_ = async_none;
+				setup_params();
+				if(res_) {
+					PQclear(res_);
+					res_ = 0;
+				}
+				res_ = PQexecParams(
+					conn_,
+					returning_query_.c_str(),
+					params_,
+					ptypes(),
+					pvalues(),
+					plengths(),
+					pformats(),
+					0 // result format - text
+					);
+				if(PQresultStatus(res_) != PGRES_TUPLES_OK)
+					throw pqerror(res_,"query execution failed ");
+				result *ptr = new(get_arena()) result(res_,conn_,blob_);
+				res_ = 0;
+				return ptr;
 			}
 
 			virtual result *query() 
 			{
-				real_query();
+				execute();
 				switch(PQresultStatus(res_)){
 				case PGRES_TUPLES_OK:
 					{
-						result *ptr = new result(res_,conn_,blob_);
+						result *ptr = new(get_arena()) result(res_,conn_,blob_);
 						res_ = 0;
 						return ptr;
 					}
@@ -569,7 +823,7 @@ namespace cppdb {
 			}
 			virtual void exec() 
 			{
-				real_query();
+				execute();
 				switch(PQresultStatus(res_)){
 				case PGRES_TUPLES_OK:
 					throw pqerror("Query used instread of statement");
@@ -585,6 +839,8 @@ namespace cppdb {
 			{
 				PGresult *res = 0;
 				long long rowid = 0;
+				if(*async_active_)
+					(*async_active_)->finish_async();
 				try {
 					char const * const param_ptr = sequence.c_str();
 					res = PQexecParams(	conn_,
@@ -602,11 +858,7 @@ namespace cppdb {
 					char const *val = PQgetvalue(res,0,0);
 					if(!val || *val==0)
 						throw pqerror("Failed to get value for sequence id");
-					fmt_.str(val);
-					fmt_.clear();
-					fmt_ >> rowid;
-					fmt_.str(std::string());
-					fmt_.clear();
+					rowid = parse_number<long long>(val,val+strlen(val));
 				}
 				catch(...) {
 					if(res) PQclear(res);
@@ -621,13 +873,7 @@ namespace cppdb {
 					char const *s=PQcmdTuples(res_);
 					if(!s || !*s)
 						return 0;
-					unsigned long long rows = 0;
-					fmt_.str(s);
-					fmt_.clear();
-					fmt_ >> rows;
-					fmt_.str(std::string());
-					fmt_.clear();
-					return rows;
+					return parse_number<unsigned long long>(s,s+strlen(s));
 				}
 				return 0;
 			}
@@ -636,16 +882,92 @@ namespace cppdb {
 				return orig_query_;
 			}
 		private:
+			//
+			// Replace the ? placeholders outside of strings by $1, $2, ..., counting them in params
+			//
+			std::string number_placeholders(std::string const &src_query,unsigned &params)
+			{
+				std::string res;
+				res.reserve(src_query.size());
+				bool inside_string=false;
+				for(unsigned i=0;i<src_query.size();i++) {
+					char c=src_query[i];
+					if(c=='\'') {
+						inside_string = !inside_string;
+					}
+					if(!inside_string && c=='?') {
+						res+='$';
+						params++;
+						fmt_<<params;
+						res+=fmt_.str();
+						fmt_.str(std::string());
+						fmt_.clear();
+					}
+					else {
+						res+=c;
+					}
+				}
+				return res;
+			}
+			typedef enum {
+				async_none,	// no asynchronous execution
+				async_running,	// the query is sent and its results are read
+				async_completed	// all results are read, waiting for query() or exec()
+			} async_state;
+
 			void check(int col)
 			{
 				if(col < 1 || col > int(params_))
 					throw invalid_placeholder();
 			}
+			//
+			// Only one query can be sent on the connection, any command waits for the
+			// query sent by another statement first, otherwise libpq discards its results
+			//
+			void finish_other_async()
+			{
+				if(*async_active_ && *async_active_ != this)
+					(*async_active_)->finish_async();
+			}
+			void keep_result(PGresult *r)
+			{
+				// the first result is the outcome of the single query
+				if(!res_)
+					res_ = r;
+				else
+					PQclear(r);
+			}
+			void complete_async()
+			{
+				async_ = async_completed;
+				if(*async_active_ == this)
+					*async_active_ = 0;
+			}
+			void wait_async()
+			{
+				finish_async();
+				async_ = async_none;
+				if(!async_error_.empty()) {
+					std::string msg;
+					msg.swap(async_error_);
+					throw cppdb_error(msg);
+				}
+			}
 			PGresult *res_;
 			PGconn *conn_;
+			statement **async_active_;
+			async_state async_;
+			std::string async_error_;
+			std::vector<char const *> values_;
+			std::vector<int> lengths_;
+			std::vector<int> formats_;
+			std::vector<Oid> types_;
 
 			std::string query_;
 			std::string orig_query_;
+			// the query rewritten by exec_returning() and its numbered form
+			std::string returning_src_;
+			std::string returning_query_;
 			unsigned params_;
 			std::vector<std::string> params_values_;
 			std::vector<char const *> params_pvalues_;
@@ -654,6 +976,7 @@ namespace cppdb {
 			std::string prepared_id_;
 			std::stringstream fmt_;
 			blob_type blob_;
+			int binary_params_;
 		};
 
 		//////////////
@@ -666,7 +989,8 @@ namespace cppdb {
 					{"engine", "postgresql"},
 					{"type_autoincrement_pk", "serial primary key not null"},
 					{"blob", default_blob},
-					{"sequence_last", "select currval(?)"}
+					{"sequence_last", "select currval(?)"},
+					{"insert_returning", "returning"}
 				});
 			}
 		public:
@@ -683,8 +1007,14 @@ namespace cppdb {
 
 		class connection : public backend::connection {
 		public:
+			void finish_async()
+			{
+				if(async_active_)
+					async_active_->finish_async();
+			}
 			void do_simple_exec(char const *s)
 			{
+				finish_async();
 				PGresult *r=PQexec(conn_,s);
 				try {
 					
@@ -712,11 +1042,22 @@ namespace cppdb {
 			}
 			virtual statement *prepare_statement(std::string const &q)
 			{
-				return new statement(conn_,q,blob_,++prepared_id_);
+				finish_async();
+				return new statement(conn_,&async_active_,q,blob_,++prepared_id_,binary_params_);
 			}
 			virtual statement *create_statement(std::string const &q)
 			{
-				return new statement(conn_,q,blob_,0);
+				return new statement(conn_,&async_active_,q,blob_,0,binary_params_);
+			}
+			virtual bool poll_async()
+			{
+				if(!async_active_)
+					return true;
+				return async_active_->poll_async();
+			}
+			virtual int async_socket()
+			{
+				return PQsocket(conn_);
 			}
 			std::string do_escape(char const *b,size_t length)
 			{
@@ -755,6 +1096,7 @@ namespace cppdb {
 			connection(connection_info const &ci) :
 				backend::connection(ci),
 				conn_(0),
+				async_active_(0),
 				prepared_id_(0)
 			{
 				std::string pq=ci.conn_str(" ", escape_for_conn);
@@ -769,6 +1111,13 @@ namespace cppdb {
 				if (blob != default_blob) {
 					dialect_ = new dialect({{"blob", blob}});
 				}
+				std::string param_format = ci.get("@param_format","binary");
+				if(param_format == "binary")
+					binary_params_ = binary_timestamp | binary_numeric;
+				else if(param_format == "text")
+					binary_params_ = 0;
+				else
+					throw pqerror("@param_format property should be either binary or text");
 
 				conn_ = 0;
 				try {
@@ -777,6 +1126,10 @@ namespace cppdb {
 						throw pqerror("failed to create connection object");
 					if(PQstatus(conn_)!=CONNECTION_OK)
 						throw pqerror(conn_,"failed to connect");
+					// old servers may keep the timestamps as floating point
+					char const *integer_datetimes = PQparameterStatus(conn_,"integer_datetimes");
+					if(!integer_datetimes || strcmp(integer_datetimes,"on")!=0)
+						binary_params_ &= ~binary_timestamp;
 				}
 				catch(...) {
 					if(conn_) {
@@ -788,6 +1141,7 @@ namespace cppdb {
 			}
 			virtual ~connection()
 			{
+				clear_cache();
 				PQfinish(conn_);
 			}
 			virtual std::string driver() const
@@ -800,7 +1154,9 @@ namespace cppdb {
 			}
 		private:
 			PGconn *conn_;
+			statement *async_active_;
 			unsigned long long prepared_id_;
+			int binary_params_;
 			blob_type blob_;
 		};
 
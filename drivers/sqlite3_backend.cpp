@@ -24,11 +24,16 @@
 #include <cppdb/backend.h>
 #include <cppdb/errors.h>
 #include <cppdb/utils.h>
+#include <cppdb/numeric_util.h>
+#include <cppdb/sqlite3_backend.h>
 
 #include <sstream>
 #include <limits>
+#include <cmath>
 #include <iomanip>
 #include <map>
+#include <vector>
+#include <typeinfo>
 #include <stdlib.h>
 #include <string.h>
 
@@ -37,11 +42,17 @@ namespace cppdb {
 		
 		class result : public backend::result {
 		public:
-			result(sqlite3_stmt *st,sqlite3 *conn) : 
+			///
+			/// \a row is the result of the first sqlite3_step() that is done by statement::query(),
+			/// it allows to tell if the result is empty before the first call of next()
+			///
+			result(sqlite3_stmt *st,sqlite3 *conn,bool row) : 
 				st_(st),
 				conn_(conn),
 				column_names_prepared_(false),
-				cols_(-1)
+				cols_(-1),
+				started_(false),
+				has_row_(row)
 			{
 				cols_=sqlite3_column_count(st_);
 			}
@@ -51,25 +62,49 @@ namespace cppdb {
 			}
 			virtual next_row has_next()
 			{
+				if(!has_row_)
+					return last_row_reached;
+				if(!started_)
+					return next_row_exists;
 				return next_row_unknown;
 			}
 			virtual bool next() 
 			{
+				if(!started_) {
+					started_ = true;
+					return has_row_;
+				}
+				// never step after SQLITE_DONE as it restarts the statement
+				if(!has_row_)
+					return false;
 				int r = sqlite3_step(st_);
-				if(r==SQLITE_DONE)
+				if(r==SQLITE_DONE) {
+					has_row_ = false;
 					return false;
+				}
 				if(r!=SQLITE_ROW) {
+					has_row_ = false;
 					throw cppdb_error(std::string("sqlite3:") + sqlite3_errmsg(conn_));
 				}
 				return true;
 			}
 			template<typename T>
+			T parse_text(int col)
+			{
+				char const *txt = (char const *)sqlite3_column_text(st_,col);
+				return parse_number<T>(txt,txt + sqlite3_column_bytes(st_,col));
+			}
+			template<typename T>
 			bool do_fetch(int col,T &v)
 			{
-				if(do_is_null(col))
-					return false;
-				if(sqlite3_column_type(st_,col)==SQLITE_NULL)
+				int type = column_type(col);
+				if(type==SQLITE_NULL)
 					return false;
+				if(type==SQLITE_TEXT) {
+					v=parse_text<T>(col);
+					return true;
+				}
+				// for integer storage class this is direct access, otherwise SQLite converts the value
 				sqlite3_int64 rv = sqlite3_column_int64(st_,col);
 				T tmp;
 				if(std::numeric_limits<T>::is_signed) {
@@ -124,9 +159,15 @@ namespace cppdb {
 			template<typename T>
 			bool do_real_fetch(int col,T &v)
 			{
-				if(do_is_null(col))
+				int type = column_type(col);
+				if(type==SQLITE_NULL)
 					return false;
-				v=static_cast<T>(sqlite3_column_double(st_,col));
+				if(type==SQLITE_INTEGER)
+					v=static_cast<T>(sqlite3_column_int64(st_,col));
+				else if(type==SQLITE_TEXT)
+					v=parse_text<T>(col);
+				else
+					v=static_cast<T>(sqlite3_column_double(st_,col));
 				return true;
 			}
 			virtual bool fetch(int col,float &v) 
@@ -163,7 +204,42 @@ namespace cppdb {
 			{
 				if(do_is_null(col))
 					return false;
-				v=parse_datetime((char const *)(sqlite3_column_text(st_,col)));
+				char const *txt = (char const *)sqlite3_column_text(st_,col);
+				v=parse_datetime(txt,txt + sqlite3_column_bytes(st_,col));
+				return true;
+			}
+			virtual bool fetch(int col,sys_microseconds &v)
+			{
+				int type = column_type(col);
+				if(type==SQLITE_NULL)
+					return false;
+				if(type==SQLITE_INTEGER) {
+					// integer storage is microseconds since the epoch
+					v=sys_microseconds(std::chrono::microseconds(sqlite3_column_int64(st_,col)));
+				}
+				else if(type==SQLITE_FLOAT) {
+					// real storage is a Julian day number as used by SQLite date functions
+					double days = sqlite3_column_double(st_,col) - 2440587.5;
+					v=sys_microseconds(std::chrono::microseconds(static_cast<long long>(std::floor(days * 86400e6 + 0.5))));
+				}
+				else {
+					char const *txt = (char const *)sqlite3_column_text(st_,col);
+					v=parse_timestamp(txt,txt + sqlite3_column_bytes(st_,col));
+				}
+				return true;
+			}
+			virtual bool fetch(int col,decimal &v)
+			{
+				int type = column_type(col);
+				if(type==SQLITE_NULL)
+					return false;
+				if(type==SQLITE_INTEGER) {
+					v=decimal(sqlite3_column_int64(st_,col));
+				}
+				else {
+					char const *txt = (char const *)sqlite3_column_text(st_,col);
+					v=parse_decimal(txt,txt + sqlite3_column_bytes(st_,col));
+				}
 				return true;
 			}
 			virtual bool is_null(int col)
@@ -200,11 +276,30 @@ namespace cppdb {
 				}
 				return name;
 			}
+			virtual std::string declared_type(int col)
+			{
+				check(col);
+				if(declared_types_.empty()) {
+					declared_types_.resize(cols_);
+					for(int i=0;i<cols_;i++) {
+						char const *type = sqlite3_column_decltype(st_,i);
+						if(type)
+							declared_types_[i]=type;
+					}
+				}
+				return declared_types_[col];
+			}
 		private:
-			bool do_is_null(int col)
+			int column_type(int col)
 			{
 				check(col);
-				return sqlite3_column_type(st_,col)==SQLITE_NULL;
+				if(!started_ || !has_row_)
+					throw empty_row_access();
+				return sqlite3_column_type(st_,col);
+			}
+			bool do_is_null(int col)
+			{
+				return column_type(col)==SQLITE_NULL;
 			}
 			void check(int col)
 			{
@@ -214,8 +309,11 @@ namespace cppdb {
 			sqlite3_stmt *st_;
 			sqlite3 *conn_;
 			std::map<std::string,int> column_names_;
+			std::vector<std::string> declared_types_;
 			bool column_names_prepared_;
 			int cols_;
+			bool started_;
+			bool has_row_;
 		};
 
 		class statement : public backend::statement {
@@ -224,6 +322,12 @@ namespace cppdb {
 			{
 				reset_stat();
 				sqlite3_clear_bindings(st_);
+				for(size_t i=0;i<params_.size();i++)
+					params_[i].type = SQLITE_NULL;
+				if(returning_st_) {
+					sqlite3_reset(returning_st_);
+					sqlite3_clear_bindings(returning_st_);
+				}
 			}
 			void reset_stat()
 			{
@@ -234,95 +338,130 @@ namespace cppdb {
 			}
 			virtual void bind(int col,std::string const &v) 
 			{
-				reset_stat();
-				check_bind(sqlite3_bind_text(st_,col,v.c_str(),v.size(),SQLITE_TRANSIENT));
+				bind_text(col,v.c_str(),v.size());
 			}
 			virtual void bind(int col,char const *s)
 			{
-				reset_stat();
-				check_bind(sqlite3_bind_text(st_,col,s,-1,SQLITE_TRANSIENT));
+				bind_text(col,s,strlen(s));
 			}
 			virtual void bind(int col,char const *b,char const *e) 
 			{
-				reset_stat();
-				check_bind(sqlite3_bind_text(st_,col,b,e-b,SQLITE_TRANSIENT));
+				bind_text(col,b,e-b);
 			}
 			virtual void bind(int col,std::tm const &v)
 			{
-				reset_stat();
-				std::string tmp = cppdb::format_datetime(v);
-				check_bind(sqlite3_bind_text(st_,col,tmp.c_str(),tmp.size(),SQLITE_TRANSIENT));
+				char buf[datetime_buffer_size];
+				char *end = cppdb::format_datetime(buf,v);
+				bind_text(col,buf,end-buf);
+			}
+			virtual void bind(int col,sys_microseconds const &v)
+			{
+				if(!text_timestamps_) {
+					// microseconds since the epoch, see fetch(int,sys_microseconds &)
+					bind_int64(col,v.time_since_epoch().count());
+					return;
+				}
+				// the text compares with std::tm values and works with SQLite date functions
+				char buf[datetime_buffer_size];
+				char *end = cppdb::format_timestamp(buf,v);
+				bind_text(col,buf,end-buf);
+			}
+			virtual void bind(int col,decimal const &v)
+			{
+				long long integer = static_cast<long long>(v.low);
+				if(v.scale == 0 && v.high == (integer < 0 ? -1 : 0)) {
+					bind_int64(col,integer);
+					return;
+				}
+				char buf[datetime_buffer_size];
+				char *end = cppdb::format_decimal(buf,v);
+				bind_text(col,buf,end-buf);
 			}
 			virtual void bind(int col,std::istream &v) 
 			{
-				reset_stat();
 				// TODO Fix me
 				std::ostringstream ss;
 				ss<<v.rdbuf();
 				std::string tmp = ss.str();
-				check_bind(sqlite3_bind_text(st_,col,tmp.c_str(),tmp.size(),SQLITE_TRANSIENT));
+				bind_text(col,tmp.c_str(),tmp.size());
 			}
 			virtual void bind(int col,int v) 
 			{
-				reset_stat();
-				check_bind(sqlite3_bind_int(st_,col,v));
-			}
-			template<typename IntType>
-			void do_bind(int col,IntType value)
-			{
-				reset_stat();
-				int r;
-				if(sizeof(value) > sizeof(int) || (long long)(value) > std::numeric_limits<int>::max())
-					r = sqlite3_bind_int64(st_,col,static_cast<sqlite3_int64>(value));
-				else
-					r = sqlite3_bind_int(st_,col,static_cast<int>(value));
-				check_bind(r);
+				bind_int64(col,v);
 			}
 			virtual void bind(int col,unsigned v) 
 			{
-				do_bind(col,v);
+				bind_int64(col,v);
 			}
 			virtual void bind(int col,long v)
 			{
-				do_bind(col,v);
+				bind_int64(col,v);
 			}
 			virtual void bind(int col,unsigned long v)
 			{
-				do_bind(col,v);
+				bind_int64(col,static_cast<sqlite3_int64>(v));
 			}
 			virtual void bind(int col,long long v)
 			{
-				do_bind(col,v);
+				bind_int64(col,v);
 			}
 			virtual void bind(int col,unsigned long long v)
 			{
-				do_bind(col,v);
+				bind_int64(col,static_cast<sqlite3_int64>(v));
 			}
 			virtual void bind(int col,double v)
 			{
-				reset_stat();
+				param &p = record(col,SQLITE_FLOAT);
+				p.real = v;
 				check_bind(sqlite3_bind_double(st_,col,v));
 			}
 			virtual void bind(int col,long double v) 
 			{
-				reset_stat();
-				check_bind(sqlite3_bind_double(st_,col,static_cast<double>(v)));
+				bind(col,static_cast<double>(v));
 			}
 			virtual void bind_null(int col)
 			{
-				reset_stat();
+				record(col,SQLITE_NULL);
 				check_bind(sqlite3_bind_null(st_,col));
 			}
 			virtual result *query()
 			{
 				reset_stat();
 				reset_ = false;
-				return new result(st_,conn_);
+				int r = sqlite3_step(st_);
+				if(r!=SQLITE_ROW && r!=SQLITE_DONE)
+					throw cppdb_error(std::string("sqlite3:") + sqlite3_errmsg(conn_));
+				return new(get_arena()) result(st_,conn_,r==SQLITE_ROW);
 			}
 			virtual long long sequence_last(std::string const &/*name*/)
 			{
 				return sqlite3_last_insert_rowid(conn_);
 			}
+			virtual backend::result *exec_returning(std::vector<std::string> const &columns)
+			{
+				// RETURNING is supported since sqlite 3.35
+				if(sqlite3_libversion_number() < 3035000)
+					return backend::statement::exec_returning(columns);
+				std::string const &q = returning_query(columns);
+				if(q.empty())
+					return backend::statement::exec_returning(columns);
+				if(!returning_st_ || returning_sql_ != q) {
+					sqlite3_finalize(returning_st_);
+					returning_st_ = 0;
+					returning_sql_.clear();
+					if(sqlite3_prepare_v2(conn_,q.c_str(),q.size(),&returning_st_,0)!=SQLITE_OK)
+						throw cppdb_error(sqlite3_errmsg(conn_));
+					returning_sql_ = q;
+				}
+				sqlite3_reset(returning_st_);
+				// the values bound to st_ are kept, bind the same to the rewritten statement
+				for(int i=0;i<int(params_.size());i++)
+					check_bind(bind_param(returning_st_,i+1,params_[i],SQLITE_TRANSIENT));
+				int r = sqlite3_step(returning_st_);
+				if(r!=SQLITE_ROW && r!=SQLITE_DONE)
+					throw cppdb_error(std::string("sqlite3:") + sqlite3_errmsg(conn_));
+				return new(get_arena()) result(returning_st_,conn_,r==SQLITE_ROW);
+			}
 			virtual void exec()
 			{
 				reset_stat();
@@ -344,21 +483,73 @@ namespace cppdb {
 			{
 				return sql_query_;
 			}
-			statement(std::string const &query,sqlite3 *conn) :
+			statement(std::string const &query,sqlite3 *conn,bool text_timestamps) :
 				st_(0),
+				returning_st_(0),
 				conn_(conn),
 				reset_(true),
+				text_timestamps_(text_timestamps),
 				sql_query_(query)
 			{
 				if(sqlite3_prepare_v2(conn_,query.c_str(),query.size(),&st_,0)!=SQLITE_OK)
 					throw cppdb_error(sqlite3_errmsg(conn_));
+				params_.resize(sqlite3_bind_parameter_count(st_));
 			}
 			~statement()
 			{
 				sqlite3_finalize(st_);
+				sqlite3_finalize(returning_st_);
 			}
 
 		private:
+			//
+			// A copy of a bound value, exec_returning() binds it to the rewritten statement.
+			// The text is bound to st_ with SQLITE_STATIC from here, so SQLite does not copy it again,
+			// st_ is reset before it changes
+			//
+			struct param {
+				int type;
+				sqlite3_int64 integer;
+				double real;
+				std::string text;
+				param() : type(SQLITE_NULL), integer(0), real(0) {}
+			};
+			param &record(int col,int type)
+			{
+				if(col < 1 || col > int(params_.size()))
+					throw invalid_placeholder();
+				reset_stat();
+				param &p = params_[col-1];
+				p.type = type;
+				return p;
+			}
+			void bind_text(int col,char const *s,size_t n)
+			{
+				param &p = record(col,SQLITE_TEXT);
+				p.text.assign(s,n);
+				check_bind(bind_param(st_,col,p,SQLITE_STATIC));
+			}
+			void bind_int64(int col,sqlite3_int64 v)
+			{
+				param &p = record(col,SQLITE_INTEGER);
+				p.integer = v;
+				check_bind(bind_param(st_,col,p,SQLITE_STATIC));
+			}
+			static int bind_param(sqlite3_stmt *st,int col,param const &p,sqlite3_destructor_type text_type)
+			{
+				switch(p.type) {
+				case SQLITE_INTEGER:
+					if(p.integer >= std::numeric_limits<int>::min() && p.integer <= std::numeric_limits<int>::max())
+						return sqlite3_bind_int(st,col,static_cast<int>(p.integer));
+					return sqlite3_bind_int64(st,col,p.integer);
+				case SQLITE_FLOAT:
+					return sqlite3_bind_double(st,col,p.real);
+				case SQLITE_TEXT:
+					return sqlite3_bind_text(st,col,p.text.c_str(),p.text.size(),text_type);
+				default:
+					return sqlite3_bind_null(st,col);
+				}
+			}
 			void check_bind(int v)
 			{
 				if(v==SQLITE_RANGE) {
@@ -369,8 +560,13 @@ namespace cppdb {
 				}
 			}
 			sqlite3_stmt *st_;
+			std::vector<param> params_;
+			// the statement rewritten by exec_returning()
+			sqlite3_stmt *returning_st_;
+			std::string returning_sql_;
 			sqlite3 *conn_;
 			bool reset_;
+			bool text_timestamps_;
 			std::string sql_query_;
 		};
 		//////////////
@@ -384,7 +580,8 @@ namespace cppdb {
 					{"bigint", "integer"},
 					{"type_autoincrement_pk", "integer primary key autoincrement not null"},
 					{"blob", "blob"},
-					{"sequence_last", "select last_insert_rowid()"}
+					{"sequence_last", "select last_insert_rowid()"},
+					{"insert_returning", "returning"}
 				});
 			}
 		public:
@@ -399,7 +596,175 @@ namespace cppdb {
 			}
 		};
 
-		class connection : public backend::connection {
+		//////////////
+		// user defined functions
+		//////////////
+		class function_call : public function_arguments, public function_result {
+		public:
+			function_call(sqlite3_context *ctx,int argc,sqlite3_value **argv) :
+				ctx_(ctx),
+				argc_(argc),
+				argv_(argv)
+			{
+			}
+			virtual int size() const
+			{
+				return argc_;
+			}
+			virtual bool is_null(int i) const
+			{
+				return sqlite3_value_type(value(i))==SQLITE_NULL;
+			}
+			virtual long long get_int64(int i) const
+			{
+				return sqlite3_value_int64(value(i));
+			}
+			virtual double get_double(int i) const
+			{
+				return sqlite3_value_double(value(i));
+			}
+			virtual char const *get_text(int i,size_t &length) const
+			{
+				char const *txt = (char const *)sqlite3_value_text(value(i));
+				length = sqlite3_value_bytes(value(i));
+				if(!txt && length!=0)
+					throw std::bad_alloc();
+				return txt ? txt : "";
+			}
+			virtual void set_null()
+			{
+				sqlite3_result_null(ctx_);
+			}
+			virtual void set(long long v)
+			{
+				sqlite3_result_int64(ctx_,v);
+			}
+			virtual void set(double v)
+			{
+				sqlite3_result_double(ctx_,v);
+			}
+			virtual void set(char const *b,char const *e)
+			{
+				sqlite3_result_text(ctx_,b,e-b,SQLITE_TRANSIENT);
+			}
+		private:
+			sqlite3_value *value(int i) const
+			{
+				if(i < 0 || i >= argc_)
+					throw invalid_column();
+				return argv_[i];
+			}
+			sqlite3_context *ctx_;
+			int argc_;
+			sqlite3_value **argv_;
+		};
+
+		// must be called from catch block
+		static void report_function_error(sqlite3_context *ctx)
+		{
+			try {
+				throw;
+			}
+			catch(std::bad_alloc const &) {
+				sqlite3_result_error_nomem(ctx);
+			}
+			catch(std::exception const &e) {
+				sqlite3_result_error(ctx,e.what(),-1);
+			}
+			catch(...) {
+				sqlite3_result_error(ctx,"sqlite3:unknown exception in user defined function",-1);
+			}
+		}
+
+		static void scalar_callback(sqlite3_context *ctx,int argc,sqlite3_value **argv)
+		{
+			try {
+				function_call call(ctx,argc,argv);
+				static_cast<scalar_function *>(sqlite3_user_data(ctx))->call(call,call);
+			}
+			catch(...) {
+				report_function_error(ctx);
+			}
+		}
+
+		// the state pointer is stored in the memory allocated by sqlite3_aggregate_context
+		static aggregate_state **aggregate_context(sqlite3_context *ctx,bool create)
+		{
+			aggregate_state **p = static_cast<aggregate_state **>(
+				sqlite3_aggregate_context(ctx,create ? sizeof(aggregate_state *) : 0));
+			if(!p) {
+				if(create)
+					throw std::bad_alloc();
+				return 0;
+			}
+			if(!*p && create)
+				*p = static_cast<aggregate_function *>(sqlite3_user_data(ctx))->create();
+			return p;
+		}
+
+		static void step_callback(sqlite3_context *ctx,int argc,sqlite3_value **argv)
+		{
+			try {
+				function_call call(ctx,argc,argv);
+				(*aggregate_context(ctx,true))->step(call);
+			}
+			catch(...) {
+				report_function_error(ctx);
+			}
+		}
+
+		static void inverse_callback(sqlite3_context *ctx,int argc,sqlite3_value **argv)
+		{
+			try {
+				function_call call(ctx,argc,argv);
+				(*aggregate_context(ctx,true))->inverse(call);
+			}
+			catch(...) {
+				report_function_error(ctx);
+			}
+		}
+
+		static void value_callback(sqlite3_context *ctx)
+		{
+			try {
+				function_call call(ctx,0,0);
+				(*aggregate_context(ctx,true))->value(call);
+			}
+			catch(...) {
+				report_function_error(ctx);
+			}
+		}
+
+		static void final_callback(sqlite3_context *ctx)
+		{
+			std::unique_ptr<aggregate_state> state;
+			try {
+				aggregate_state **p = aggregate_context(ctx,false);
+				if(p && *p) {
+					state.reset(*p);
+					*p = 0;
+				}
+				else {
+					// no rows in the group
+					state.reset(static_cast<aggregate_function *>(sqlite3_user_data(ctx))->create());
+				}
+				function_call call(ctx,0,0);
+				state->value(call);
+			}
+			catch(...) {
+				report_function_error(ctx);
+			}
+		}
+
+		template<typename Function>
+		static void release_callback(void *p)
+		{
+			Function *f = static_cast<Function *>(p);
+			if(f->del_ref()==0)
+				Function::dispose(f);
+		}
+
+		class connection : public backend::connection, public extension {
 		public:
 			connection(connection_info const &ci) :
 				backend::connection(ci),
@@ -423,10 +788,23 @@ namespace cppdb {
 								" 'create' (default), 'readwrite' or 'readonly' values");
 				}
 
+				if(dbname.compare(0,5,"file:")==0)
+					flags |= SQLITE_OPEN_URI;
+
 				std::string vfs = ci.get("vfs");
 				char const *cvfs = vfs.empty() ? (char const *)(0) : vfs.c_str();
 				
 				int busy = ci.get("busy_timeout",-1);
+
+				std::string timestamp_format = ci.get("timestamp_format","integer");
+				if(timestamp_format == "integer")
+					text_timestamps_ = false;
+				else if(timestamp_format == "text")
+					text_timestamps_ = true;
+				else {
+					throw cppdb_error("sqlite3:invalid timestamp_format property, expected "
+								" 'integer' (default) or 'text' values");
+				}
 				
 				try {
 					if(sqlite3_open_v2(dbname.c_str(),&conn_,flags,cvfs)!=SQLITE_OK) {
@@ -470,7 +848,7 @@ namespace cppdb {
 			}
 			virtual statement *prepare_statement(std::string const &q)
 			{
-				return new statement(q,conn_);
+				return new statement(q,conn_,text_timestamps_);
 			}
 			virtual statement *create_statement(std::string const &q)
 			{
@@ -505,7 +883,96 @@ namespace cppdb {
 			{
 				return "sqlite3";
 			}
+			virtual void *get_extension(std::type_info const &type)
+			{
+				if(type == typeid(extension))
+					return static_cast<extension *>(this);
+				return backend::connection::get_extension(type);
+			}
+			virtual void create_function(std::string const &name,int args,ref_ptr<scalar_function> f,bool deterministic)
+			{
+				// released by SQLite using release_callback, also on failure
+				f->add_ref();
+				check_function(sqlite3_create_function_v2(conn_,name.c_str(),args,function_flags(deterministic),
+									f.get(),scalar_callback,0,0,release_callback<scalar_function>));
+			}
+			virtual void create_aggregate(std::string const &name,int args,ref_ptr<aggregate_function> f,bool deterministic)
+			{
+				f->add_ref();
+				check_function(sqlite3_create_function_v2(conn_,name.c_str(),args,function_flags(deterministic),
+									f.get(),0,step_callback,final_callback,release_callback<aggregate_function>));
+			}
+			virtual void create_window_function(std::string const &name,int args,ref_ptr<aggregate_function> f,bool deterministic)
+			{
+				#if SQLITE_VERSION_NUMBER >= 3025000
+				f->add_ref();
+				check_function(sqlite3_create_window_function(conn_,name.c_str(),args,function_flags(deterministic),
+									f.get(),step_callback,final_callback,value_callback,inverse_callback,
+									release_callback<aggregate_function>));
+				#else
+				(void)(name); (void)(args); (void)(f); (void)(deterministic);
+				throw not_supported_by_backend("sqlite3:window functions require SQLite 3.25 or later");
+				#endif
+			}
+			virtual void remove_function(std::string const &name,int args)
+			{
+				check_function(sqlite3_create_function_v2(conn_,name.c_str(),args,SQLITE_UTF8,0,0,0,0,0));
+			}
+			virtual void backup_to(extension &target,int pages_per_step,backup_progress *progress,int sleep_ms)
+			{
+				// the only implementation of the extension
+				sqlite3 *dst = static_cast<connection &>(target).conn_;
+				if(pages_per_step <= 0)
+					pages_per_step = -1;
+				sqlite3_backup *b = sqlite3_backup_init(dst,"main",conn_,"main");
+				if(!b)
+					throw cppdb_error(std::string("sqlite3:failed to start backup:") + sqlite3_errmsg(dst));
+				int r = SQLITE_OK;
+				bool aborted = false;
+				try {
+					for(;;) {
+						r = sqlite3_backup_step(b,pages_per_step);
+						if(r!=SQLITE_OK && r!=SQLITE_DONE && r!=SQLITE_BUSY && r!=SQLITE_LOCKED)
+							break;
+						if(progress && !progress->step(sqlite3_backup_remaining(b),sqlite3_backup_pagecount(b))) {
+							aborted = r!=SQLITE_DONE;
+							break;
+						}
+						if(r==SQLITE_DONE)
+							break;
+						if(sleep_ms > 0)
+							sqlite3_sleep(sleep_ms);
+						else if(r!=SQLITE_OK) // busy or locked, let the writer finish
+							sqlite3_sleep(1);
+					}
+				}
+				catch(...) {
+					sqlite3_backup_finish(b);
+					throw;
+				}
+				int fr = sqlite3_backup_finish(b);
+				if(aborted)
+					throw cppdb_error("sqlite3:backup aborted");
+				if(r!=SQLITE_DONE || fr!=SQLITE_OK)
+					throw cppdb_error(std::string("sqlite3:backup failed:") + sqlite3_errmsg(dst));
+			}
 		private:
+			static int function_flags(bool deterministic)
+			{
+				int flags = SQLITE_UTF8;
+				#ifdef SQLITE_DETERMINISTIC
+				if(deterministic)
+					flags |= SQLITE_DETERMINISTIC;
+				#else
+				(void)(deterministic);
+				#endif
+				return flags;
+			}
+			void check_function(int r)
+			{
+				if(r!=SQLITE_OK)
+					throw cppdb_error(std::string("sqlite3:failed to register function:") + sqlite3_errmsg(conn_));
+			}
 			void fast_exec(char const *query)
 			{
 				if(sqlite3_exec(conn_,query,0,0,0)!=SQLITE_OK) {
@@ -514,6 +981,7 @@ namespace cppdb {
 			}
 
 			sqlite3 *conn_;
+			bool text_timestamps_;
 		};
 
 	} // sqlite3_backend
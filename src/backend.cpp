@@ -18,6 +18,7 @@
 #define CPPDB_SOURCE
 #include <cppdb/backend.h>
 #include <cppdb/utils.h>
+#include <cppdb/numeric_util.h>
 #include <cppdb/pool.h>
 
 #include <map>
@@ -28,13 +29,192 @@
 
 namespace cppdb {
 	namespace backend {
+		//arena
+		struct arena::data {
+			std::pmr::synchronized_pool_resource pool;
+		};
+		arena::arena() : d(new arena::data()) {}
+		arena::~arena() {}
+		std::pmr::memory_resource *arena::resource()
+		{
+			return &d->pool;
+		}
+
+		namespace {
+			// Every block of a result starts with its owner, so delete can return it there
+			struct block_header {
+				arena *owner;
+				size_t size;
+			};
+			size_t const block_align = alignof(std::max_align_t);
+			size_t const header_size = (sizeof(block_header) + block_align - 1) / block_align * block_align;
+		}
+
 		//result
 		struct result::data {};
+		void *result::operator new(size_t n)
+		{
+			return operator new(n,static_cast<arena *>(0));
+		}
+		void *result::operator new(size_t n,arena *a)
+		{
+			size_t total = n + header_size;
+			void *p = a ? a->resource()->allocate(total,block_align) : ::operator new(total);
+			block_header *h = static_cast<block_header *>(p);
+			h->owner = a;
+			h->size = total;
+			if(a)
+				a->add_ref();
+			return static_cast<char *>(p) + header_size;
+		}
+		void result::operator delete(void *p)
+		{
+			if(!p)
+				return;
+			block_header *h = reinterpret_cast<block_header *>(static_cast<char *>(p) - header_size);
+			arena *a = h->owner;
+			if(!a) {
+				::operator delete(h);
+				return;
+			}
+			a->resource()->deallocate(h,h->size,block_align);
+			if(a->del_ref() == 0)
+				ref_counted::dispose(a);
+		}
+		void result::operator delete(void *p,arena * /*a*/)
+		{
+			operator delete(p);
+		}
 		result::result() {}
 		result::~result() {}
+		std::string result::declared_type(int /*col*/)
+		{
+			throw not_supported_by_backend("cppdb::backend::result::declared_type is not supported by backend");
+		}
+		bool result::next_result()
+		{
+			throw not_supported_by_backend("cppdb::backend::result::next_result is not supported by backend");
+		}
+		bool result::fetch(int col,sys_microseconds &v)
+		{
+			std::string tmp;
+			if(!fetch(col,tmp))
+				return false;
+			v = parse_timestamp(tmp);
+			return true;
+		}
+		bool result::fetch(int col,decimal &v)
+		{
+			std::string tmp;
+			if(!fetch(col,tmp))
+				return false;
+			v = parse_decimal(tmp);
+			return true;
+		}
 		
+		namespace {
+			//
+			// Rows of a single integer column, the generated keys reported by the engine
+			//
+			class keys_result : public result {
+			public:
+				keys_result(std::string const &name,long long first,unsigned long long count) :
+					name_(name),
+					first_(first),
+					count_(count),
+					row_(0)
+				{
+				}
+				virtual next_row has_next()
+				{
+					return row_ < count_ ? next_row_exists : last_row_reached;
+				}
+				virtual bool next()
+				{
+					if(row_ >= count_)
+						return false;
+					row_++;
+					return true;
+				}
+				template<typename T>
+				bool do_fetch(int col,T &v)
+				{
+					check(col);
+					v = numeric_cast<T>(value());
+					return true;
+				}
+				virtual bool fetch(int col,short &v) { return do_fetch(col,v); }
+				virtual bool fetch(int col,unsigned short &v) { return do_fetch(col,v); }
+				virtual bool fetch(int col,int &v) { return do_fetch(col,v); }
+				virtual bool fetch(int col,unsigned &v) { return do_fetch(col,v); }
+				virtual bool fetch(int col,long &v) { return do_fetch(col,v); }
+				virtual bool fetch(int col,unsigned long &v) { return do_fetch(col,v); }
+				virtual bool fetch(int col,long long &v) { return do_fetch(col,v); }
+				virtual bool fetch(int col,unsigned long long &v) { return do_fetch(col,v); }
+				virtual bool fetch(int col,float &v) { return do_fetch(col,v); }
+				virtual bool fetch(int col,double &v) { return do_fetch(col,v); }
+				virtual bool fetch(int col,long double &v) { return do_fetch(col,v); }
+				virtual bool fetch(int col,std::string &v)
+				{
+					check(col);
+					char buf[number_buffer_size];
+					v.assign(buf,format_number(buf,value()));
+					return true;
+				}
+				virtual bool fetch(int col,std::ostream &v)
+				{
+					check(col);
+					char buf[number_buffer_size];
+					v.write(buf,format_number(buf,value()) - buf);
+					return true;
+				}
+				virtual bool fetch(int /*col*/,std::tm &/*v*/)
+				{
+					throw bad_value_cast();
+				}
+				virtual bool is_null(int col)
+				{
+					check(col);
+					return false;
+				}
+				virtual int cols()
+				{
+					return 1;
+				}
+				virtual int name_to_column(std::string const &n)
+				{
+					return n == name_ ? 0 : -1;
+				}
+				virtual std::string column_to_name(int col)
+				{
+					if(col != 0)
+						throw invalid_column();
+					return name_;
+				}
+			private:
+				void check(int col)
+				{
+					if(col != 0)
+						throw invalid_column();
+					if(row_ == 0 || row_ > count_)
+						throw empty_row_access();
+				}
+				long long value() const
+				{
+					return first_ + static_cast<long long>(row_ - 1);
+				}
+				std::string name_;
+				long long first_;
+				unsigned long long count_;
+				unsigned long long row_;
+			};
+		}
+
 		//statement
-		struct statement::data {};
+		struct statement::data {
+			std::vector<std::string> returning_columns;
+			std::string returning_query;
+		};
 
 		statement::statement() : cache_(0), connection_(0)
 		{
@@ -46,6 +226,38 @@ namespace cppdb {
 		{
 			cache_ = c;
 		}
+		arena *statement::get_arena()
+		{
+			return connection_ ? connection_->get_arena() : 0;
+		}
+		std::string const &statement::returning_query(std::vector<std::string> const &columns)
+		{
+			if(!d)
+				d.reset(new data());
+			if(d->returning_columns != columns || d->returning_query.empty()) {
+				d->returning_columns = columns;
+				d->returning_query.clear();
+				if(connection_) {
+					std::string const &mode = connection_->insert_returning();
+					if(mode.empty())
+						d->returning_query = connection_->get_dialect()->insert_returning(sql_query(),columns);
+					else
+						d->returning_query = dialect::rewrite_returning(mode,sql_query(),columns);
+				}
+			}
+			return d->returning_query;
+		}
+		result *statement::generated_keys(std::string const &name,long long first,unsigned long long count)
+		{
+			return new(get_arena()) keys_result(name,first,count);
+		}
+		result *statement::exec_returning(std::vector<std::string> const &columns)
+		{
+			if(columns.size() != 1)
+				throw not_supported_by_backend("cppdb::backend::statement::exec_returning of several columns is not supported by backend");
+			exec();
+			return generated_keys(columns[0],sequence_last(std::string()),1);
+		}
 
 		void statement::dispose(statement *p)
 		{
@@ -53,12 +265,33 @@ namespace cppdb {
 				return;
 			statements_cache *cache = p->cache_;
 			p->cache_ = 0;
-			if(cache) 
+			if(cache) {
+				// The connection owns the cache, so a cached statement must not keep it alive;
+				// it is released after the statement is in the cache as it may clear it
+				ref_ptr<connection> conn = p->connection_;
+				p->connection_ = 0;
 				cache->put(p);
+			}
 			else
 				delete p;
 		}
 
+		void statement::bind(int col,sys_microseconds const &v)
+		{
+			bind(col,format_timestamp(v));
+		}
+		void statement::bind(int col,decimal const &v)
+		{
+			bind(col,format_decimal(v));
+		}
+		bool statement::start_async()
+		{
+			return false;
+		}
+		bool statement::poll_async()
+		{
+			return true;
+		}
 		long long statement::sequence_last(std::string const &sequence)
 		{
 			std::string q = connection_->sequence_last();
@@ -97,31 +330,46 @@ namespace cppdb {
 			typedef std::map<std::string,entry> statements_type;
 			typedef std::list<statements_type::iterator> lru_type;
 			struct entry {
+				// null while the statement is checked out
 				ref_ptr<statement> stat;
+				// points to lru or, while checked out, to in_use
 				lru_type::iterator lru_ptr;
 			};
 			
 			statements_type statements;
+			// the idle statements, only they count against max_size and are evicted
 			lru_type lru;
+			// the entries of the checked out statements
+			lru_type in_use;
 			size_t size;
 			size_t max_size;
 
 
+			// Entries stay in the cache while their statement is in use, so a statement that
+			// goes back and forth between the cache and the user does not allocate nodes;
+			// their list nodes are moved between lru and in_use
 			void insert(ref_ptr<statement> st)
 			{
 				statements_type::iterator p;
 				if((p=statements.find(st->sql_query()))!=statements.end()) {
+					if(p->second.stat) {
+						// the same query was prepared twice, keep the last one
+						p->second.stat = st;
+						lru.splice(lru.begin(),lru,p->second.lru_ptr);
+						return;
+					}
+					if(size >= max_size && !evict()) {
+						in_use.erase(p->second.lru_ptr);
+						statements.erase(p);
+						return;
+					}
 					p->second.stat = st;
-					lru.erase(p->second.lru_ptr);
-					lru.push_front(p);
-					p->second.lru_ptr = lru.begin();
+					lru.splice(lru.begin(),in_use,p->second.lru_ptr);
+					size++;
 				}
 				else if(max_size > 0) {
-					if(size >= max_size) {
-						statements.erase(lru.back());
-						lru.pop_back();
-						size--;
-					}
+					if(size >= max_size && !evict())
+						return;
 					std::pair<statements_type::iterator,bool> ins = 
 						statements.insert(std::make_pair(st->sql_query(),entry()));
 					p = ins.first;
@@ -132,22 +380,33 @@ namespace cppdb {
 				}
 			}
 
+			bool evict()
+			{
+				if(lru.empty())
+					return false;
+				statements.erase(lru.back());
+				lru.pop_back();
+				size--;
+				return true;
+			}
+
 			ref_ptr<statement> fetch(std::string const &query)
 			{
 				ref_ptr<statement> st;
 				statements_type::iterator p = statements.find(query);
-				if(p==statements.end())
+				if(p==statements.end() || !p->second.stat)
 					return st;
-				st=p->second.stat;
-				lru.erase(p->second.lru_ptr);
-				statements.erase(p);
-				size --;
+				st = p->second.stat;
+				p->second.stat.reset();
+				in_use.splice(in_use.begin(),lru,p->second.lru_ptr);
+				size--;
 				return st;
 			}
 
 			void clear()
 			{
 				lru.clear();
+				in_use.clear();
 				statements.clear();
 				size=0;
 			}
@@ -200,6 +459,10 @@ namespace cppdb {
 		struct connection::data {
 			typedef std::list<connection_specific_data *> conn_specific_type;
 			conn_specific_type conn_specific;
+			ref_ptr<arena> memory;
+			// the @insert_returning option, overrides the dialect
+			std::string insert_returning;
+			data() : memory(new arena()) {}
 			~data()
 			{
 				for(conn_specific_type::iterator p=conn_specific.begin();p!=conn_specific.end();++p)
@@ -226,6 +489,7 @@ namespace cppdb {
 			ref_ptr<statement> st;
 			if(!cache_.active()) {
 				st = prepare_statement(q);
+				st->set_connection(this);
 				return st;
 			}
 			st = cache_.fetch(q);
@@ -255,6 +519,7 @@ namespace cppdb {
 				cache_.set_size(cache_size);
 			//}
 			sequence_last_ = info.get("@sequence_last", "");
+			d->insert_returning = info.get("@insert_returning", "");
 			std::string def_is_prep = info.get("@use_prepared","on");
 			if(def_is_prep == "on")
 				default_is_prepared_ = 1;
@@ -266,6 +531,14 @@ namespace cppdb {
 		connection::~connection()
 		{
 		}
+		arena *connection::get_arena()
+		{
+			return d->memory.get();
+		}
+		std::string const &connection::insert_returning() const
+		{
+			return d->insert_returning;
+		}
 
 		bool connection::once_called() const
 		{
@@ -320,6 +593,18 @@ namespace cppdb {
 				d->conn_specific.back() = tmp.release();
 			}
 		}
+		void *connection::get_extension(std::type_info const &/*type*/)
+		{
+			return 0;
+		}
+		bool connection::poll_async()
+		{
+			return true;
+		}
+		int connection::async_socket()
+		{
+			return -1;
+		}
 
 		ref_ptr<pool> connection::get_pool()
 		{
@@ -20,10 +20,155 @@
 #include <cppdb/backend.h>
 #include <cppdb/pool.h>
 #include <cppdb/driver_manager.h>
+#include <cppdb/utils.h>
+
+#include "read_epoch.h"
+
+#include <vector>
+#include <memory>
+#include <atomic>
 
 namespace cppdb {
-	struct connections_manager::data{};
-	connections_manager::connections_manager() {}
+	struct connections_manager::data {
+		//
+		// A connection string that was used: its parsed form and the pool if @pool_size is set.
+		// An entry is not changed once it is linked to the table
+		//
+		struct entry {
+			std::string connection_string;
+			size_t hash;
+			std::shared_ptr<connection_info const> info;
+			ref_ptr<pool> p;
+			entry const *next;
+		};
+		//
+		// Hash table of the entries, keyed by connection_info::hash(). Readers use it without a lock,
+		// writers hold lock_ and link a new entry at the head of its bucket, the table is replaced
+		// to remove entries or to grow
+		//
+		struct table {
+			table(size_t n) :
+				size(n),
+				buckets(new std::atomic<entry const *>[n]),
+				count(0),
+				unpooled(0)
+			{
+				for(size_t i=0;i<size;i++)
+					buckets[i].store(0,std::memory_order_relaxed);
+			}
+			~table()
+			{
+				for(size_t i=0;i<size;i++) {
+					entry const *e = buckets[i].load(std::memory_order_relaxed);
+					while(e) {
+						entry const *next = e->next;
+						delete e;
+						e = next;
+					}
+				}
+			}
+			entry const *find(size_t h,std::string const &cs) const
+			{
+				for(entry const *e = buckets[h % size].load(std::memory_order_acquire);e;e=e->next) {
+					if(e->hash == h && e->connection_string == cs)
+						return e;
+				}
+				return 0;
+			}
+			void link(entry *e)
+			{
+				std::atomic<entry const *> &head = buckets[e->hash % size];
+				e->next = head.load(std::memory_order_relaxed);
+				head.store(e,std::memory_order_release);
+				count++;
+				if(!e->p)
+					unpooled++;
+			}
+
+			size_t size;
+			std::unique_ptr<std::atomic<entry const *>[]> buckets;
+			size_t count;
+			size_t unpooled;
+		};
+		// limit of the parsed connection strings kept without a pool
+		static const size_t max_unpooled = 1024;
+		static const size_t min_buckets = 64;
+
+		data() : current(new table(min_buckets)) {}
+		~data()
+		{
+			delete current.load();
+		}
+
+		//
+		// Should be used while holding a read_epoch::guard on epoch or lock_
+		//
+		table const *snapshot() const
+		{
+			return current.load();
+		}
+		//
+		// Copy the entries of the current table for which \a keep returns true,
+		// should be called with lock_ held
+		//
+		template<typename Pred>
+		table *copy(Pred keep) const
+		{
+			table const *t = current.load(std::memory_order_relaxed);
+			size_t n = min_buckets;
+			while(n < t->count)
+				n *= 2;
+			std::unique_ptr<table> updated(new table(n));
+			for(size_t i=0;i<t->size;i++) {
+				for(entry const *e = t->buckets[i].load(std::memory_order_relaxed);e;e=e->next) {
+					if(keep(*e))
+						updated->link(new entry(*e));
+				}
+			}
+			return updated.release();
+		}
+		//
+		// Replace the current table and free the old one once no reader uses it,
+		// should be called with lock_ held
+		//
+		void replace(table *t)
+		{
+			table *old = current.load(std::memory_order_relaxed);
+			current.store(t);
+			epoch.synchronize();
+			delete old;
+		}
+		//
+		// Get the entry for \a ci creating it if needed, should be called with lock_ held
+		//
+		entry const *get(size_t h,std::shared_ptr<connection_info const> const &ci)
+		{
+			table *t = current.load(std::memory_order_relaxed);
+			entry const *e = t->find(h,ci->connection_string);
+			if(e)
+				return e;
+			bool pooled = ci->get("@pool_size",0)!=0;
+			if(!pooled && t->unpooled >= max_unpooled)
+				replace(copy([](entry const &x) { return bool(x.p); }));
+			else if(t->count >= t->size * 2)
+				replace(copy([](entry const &) { return true; }));
+			std::unique_ptr<entry> ne(new entry());
+			ne->connection_string = ci->connection_string;
+			ne->hash = h;
+			ne->info = ci;
+			if(pooled)
+				ne->p = pool::create(*ci);
+			ne->next = 0;
+			current.load(std::memory_order_relaxed)->link(ne.get());
+			return ne.release();
+		}
+
+		details::read_epoch epoch;
+	private:
+		std::atomic<table *> current;
+	};
+
+	connections_manager::connections_manager() : d(new data()) {}
 // Borland erros on hidden destructors in classes without only static methods.
 #ifndef __BORLANDC__
 	connections_manager::~connections_manager() {}
@@ -44,36 +189,49 @@ namespace cppdb {
 
 	ref_ptr<backend::connection> connections_manager::open(std::string const &cs)
 	{
+		size_t h = connection_info::hash(cs);
 		ref_ptr<pool> p;
-		connection_info ci(cs);
-		if(ci.get("@pool_size",0)!=0) {
+		std::shared_ptr<connection_info const> info;
+		{
+			details::read_epoch::guard g(d->epoch);
+			data::entry const *e = d->snapshot()->find(h,cs);
+			if(e) {
+				p = e->p;
+				if(!p)
+					info = e->info;
+			}
+		}
+		if(!p && !info) {
+			std::shared_ptr<connection_info const> ci = std::make_shared<connection_info const>(cs);
 			mutex::guard l(lock_);
-			connections_type::iterator pool_ptr = connections_.find(cs);
-			if(pool_ptr!=connections_.end())
-				p = pool_ptr->second;
+			data::entry const *e = d->get(h,ci);
+			p = e->p;
+			info = e->info;
 		}
-
-		if(p) {
+		if(p)
 			return p->open();
-		}
-		else {
-			return open(ci);
-		}
+		return driver_manager::instance().connect(*info);
 	}
 	ref_ptr<backend::connection> connections_manager::open(connection_info const &ci)
 	{
 		if(ci.get("@pool_size",0)==0) {
 			return driver_manager::instance().connect(ci);
 		}
+		size_t h = ci.hash();
 		ref_ptr<pool> p;
 		{
+			details::read_epoch::guard g(d->epoch);
+			data::entry const *e = d->snapshot()->find(h,ci.connection_string);
+			if(e)
+				p = e->p;
+		}
+		if(!p) {
+			std::shared_ptr<connection_info const> copy = std::make_shared<connection_info const>(ci);
 			mutex::guard l(lock_);
-			ref_ptr<pool> &ref_p = connections_[ci.connection_string];
-			if(!ref_p) {
-				ref_p = pool::create(ci);
-			}
-			p=ref_p;
+			p = d->get(h,copy)->p;
 		}
+		if(!p)
+			return driver_manager::instance().connect(ci);
 		return p->open();
 	}
 	void connections_manager::gc()
@@ -81,9 +239,13 @@ namespace cppdb {
 		std::vector<ref_ptr<pool> > pools_;
 		pools_.reserve(100);
 		{
-			mutex::guard l(lock_);
-			for(connections_type::iterator p=connections_.begin();p!=connections_.end();++p) {
-				pools_.push_back(p->second);
+			details::read_epoch::guard g(d->epoch);
+			data::table const *t = d->snapshot();
+			for(size_t i=0;i<t->size;i++) {
+				for(data::entry const *e = t->buckets[i].load(std::memory_order_acquire);e;e=e->next) {
+					if(e->p)
+						pools_.push_back(e->p);
+				}
 			}
 		}
 		for(unsigned i=0;i<pools_.size();i++) {
@@ -92,28 +254,36 @@ namespace cppdb {
 		pools_.clear();
 		{
 			mutex::guard l(lock_);
-			for(connections_type::iterator p=connections_.begin();p!=connections_.end();) {
-				if(p->second->use_count() == 1) {
-					pools_.push_back(p->second);
-					connections_type::iterator tmp = p;
-					++p;
-					connections_.erase(tmp);
-				}
-				else
-					++p;
+			// the table is the only holder of an unused pool, the connections
+			// it opened keep a reference to it
+			auto unused = [](data::entry const &e) { return e.p && e.p->use_count() == 1; };
+			data::table const *t = d->snapshot();
+			bool found = false;
+			for(size_t i=0;i<t->size && !found;i++) {
+				for(data::entry const *e = t->buckets[i].load(std::memory_order_relaxed);e && !found;e=e->next)
+					found = unused(*e);
 			}
+			if(found)
+				d->replace(d->copy([&](data::entry const &e) { return !unused(e); }));
 		}
-		pools_.clear();
-
 	}
 		
 
 	void connections_manager::clear_cache()
 	{
-		mutex::guard l(lock_);
-		for(connections_type::iterator p=connections_.begin();p!=connections_.end();++p) {
-			p->second->clear_cache();
+		std::vector<ref_ptr<pool> > pools_;
+		{
+			details::read_epoch::guard g(d->epoch);
+			data::table const *t = d->snapshot();
+			for(size_t i=0;i<t->size;i++) {
+				for(data::entry const *e = t->buckets[i].load(std::memory_order_acquire);e;e=e->next) {
+					if(e->p)
+						pools_.push_back(e->p);
+				}
+			}
 		}
+		for(unsigned i=0;i<pools_.size();i++)
+			pools_[i]->clear_cache();
 	}
 
 } // cppdb
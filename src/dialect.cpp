@@ -70,6 +70,76 @@ namespace cppdb {
 				params.size() > 1 ? params[1] : -1
 			);
 		}
+		namespace {
+			bool is_word_at(std::string const &s, size_t pos, char const *word)
+			{
+				size_t n = 0;
+				for(;word[n];n++) {
+					if(pos + n >= s.size() || std::toupper((unsigned char)(s[pos + n])) != word[n])
+						return false;
+				}
+				if(pos > 0 && (std::isalnum((unsigned char)(s[pos - 1])) || s[pos - 1] == '_'))
+					return false;
+				return pos + n == s.size() || !(std::isalnum((unsigned char)(s[pos + n])) || s[pos + n] == '_');
+			}
+			//
+			// The position of the VALUES, SELECT or DEFAULT VALUES part of an insert, outside of
+			// quotes and parentheses
+			//
+			size_t insert_source(std::string const &q)
+			{
+				char quote = 0;
+				int depth = 0;
+				for(size_t i=0;i<q.size();i++) {
+					char c = q[i];
+					if(quote) {
+						if(c == quote)
+							quote = 0;
+					}
+					else if(c == '\'' || c == '"' || c == '`')
+						quote = c;
+					else if(c == '(')
+						depth++;
+					else if(c == ')')
+						depth--;
+					else if(depth == 0 && (is_word_at(q, i, "VALUES") || is_word_at(q, i, "SELECT") || is_word_at(q, i, "DEFAULT")))
+						return i;
+				}
+				return std::string::npos;
+			}
+		}
+
+		std::string dialect::insert_returning(std::string const &query, std::vector<std::string> const &columns) const
+		{
+			return rewrite_returning(get_keyword("insert_returning", ""), query, columns);
+		}
+		std::string dialect::rewrite_returning(std::string const &mode, std::string const &query, std::vector<std::string> const &columns)
+		{
+			if(columns.empty() || (mode != "returning" && mode != "output"))
+				return std::string();
+			if(mode == "returning") {
+				size_t end = query.find_last_not_of(" \t\r\n;");
+				std::string res = query.substr(0, end == std::string::npos ? 0 : end + 1);
+				res += " RETURNING ";
+				for(size_t i=0;i<columns.size();i++) {
+					if(i > 0)
+						res += ", ";
+					res += columns[i];
+				}
+				return res;
+			}
+			size_t pos = insert_source(query);
+			if(pos == std::string::npos)
+				return std::string();
+			std::string output = "OUTPUT ";
+			for(size_t i=0;i<columns.size();i++) {
+				if(i > 0)
+					output += ", ";
+				output += "INSERTED." + columns[i];
+			}
+			output += " ";
+			return std::string(query).insert(pos, output);
+		}
 		dialect::dialect()
 		{
 			init();
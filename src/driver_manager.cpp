@@ -21,9 +21,14 @@
 #include <cppdb/backend.h>
 #include <cppdb/utils.h>
 #include <cppdb/mutex.h>
+#include "read_epoch.h"
 
 #include <vector>
 #include <list>
+#include <map>
+#include <mutex>
+#include <memory>
+#include <atomic>
 
 extern "C" {
 	#ifdef CPPDB_WITH_SQLITE3 
@@ -92,6 +97,71 @@ namespace cppdb {
 		ref_ptr<shared_object> so_;
 	};
 	
+	struct driver_manager::data {
+		//
+		// Immutable snapshot of the installed drivers, readers use the current one with a single
+		// atomic load and writers publish a modified copy while holding the lock_.
+		// The drivers are owned by the owners map, the snapshots only point to them
+		//
+		typedef std::map<std::string,backend::driver *> drivers_type;
+		typedef std::map<std::string,ref_ptr<backend::driver> > owners_type;
+		//
+		// The loading of a driver by its name, threads that need the same driver wait
+		// on the once flag, a new state is created after the driver is collected
+		//
+		struct load_state {
+			std::once_flag once;
+		};
+		typedef std::map<std::string,std::shared_ptr<load_state> > loading_type;
+
+		data() : current(new drivers_type()) {}
+		~data()
+		{
+			delete current.load();
+		}
+
+		//
+		// Should be called with lock_ held
+		//
+		drivers_type const *snapshot() const
+		{
+			return current.load(std::memory_order_relaxed);
+		}
+		//
+		// Replace the current snapshot and free the old one once the lookups that could see it
+		// are done, should be called with lock_ held. After it returns the drivers that are not
+		// in \a drivers are not used by any lookup
+		//
+		void publish(drivers_type const *drivers)
+		{
+			drivers_type const *old = current.load(std::memory_order_relaxed);
+			current.store(drivers);
+			epoch.synchronize();
+			delete old;
+		}
+		//
+		// Lookup without a lock, the read epoch keeps the snapshot and the driver alive
+		// until the driver's reference is taken
+		//
+		ref_ptr<backend::driver> find(std::string const &name)
+		{
+			ref_ptr<backend::driver> drv;
+			details::read_epoch::guard g(epoch);
+			drivers_type const *drivers = current.load();
+			drivers_type::const_iterator p = drivers->find(name);
+			if(p != drivers->end())
+				drv = p->second;
+			return drv;
+		}
+
+		// protected by lock_
+		loading_type loading;
+		owners_type owners;
+	private:
+		details::read_epoch epoch;
+		std::atomic<drivers_type const *> current;
+	};
+
 	backend::connection *driver_manager::connect(std::string const &str)
 	{
 		connection_info conn(str);
@@ -108,40 +178,55 @@ namespace cppdb {
 	}
 	ref_ptr<backend::driver> driver_manager::find_driver(connection_info const &conn, std::string const &driver_name)
 	{
-		ref_ptr<backend::driver> drv_ptr;
 		std::string const &dr_name = driver_name.empty() ? conn.driver : driver_name;
-		drivers_type::iterator p;
-		{ // get driver
-			p=drivers_.find(dr_name);
-			if(p!=drivers_.end()) {
-				drv_ptr = p->second;
-			}
-			else {
-				drv_ptr = load_driver(conn, dr_name);
-				return install_driver(dr_name, drv_ptr);
+		for(;;) {
+			ref_ptr<backend::driver> drv_ptr = d->find(dr_name);
+			if(drv_ptr)
+				return drv_ptr;
+			std::shared_ptr<data::load_state> state;
+			{
+				mutex::guard l(lock_);
+				std::shared_ptr<data::load_state> &s = d->loading[dr_name];
+				if(!s)
+					s = std::make_shared<data::load_state>();
+				state = s;
 			}
+			std::call_once(state->once,[&]() {
+				if(!d->find(dr_name))
+					install_driver(dr_name,load_driver(conn,dr_name));
+			});
+			drv_ptr = d->find(dr_name);
+			if(drv_ptr)
+				return drv_ptr;
+			// the driver was collected after it was loaded, load it again
+			mutex::guard l(lock_);
+			data::loading_type::iterator p = d->loading.find(dr_name);
+			if(p != d->loading.end() && p->second == state)
+				d->loading.erase(p);
 		}
-		return drv_ptr;
 	}
 	void driver_manager::collect_unused()
 	{
-		std::list<ref_ptr<backend::driver> > garbage;
+		// released after unlocking as they may unload modules
+		std::vector<ref_ptr<backend::driver> > removed;
 		{
 			mutex::guard lock(lock_);
-			drivers_type::iterator p=drivers_.begin(),tmp;
-			while(p!=drivers_.end()) {
+			std::unique_ptr<data::drivers_type> updated(new data::drivers_type());
+			for(data::owners_type::iterator p=d->owners.begin();p!=d->owners.end();) {
 				if(!p->second->in_use()) {
-					garbage.push_back(p->second);
-					tmp=p;
-					++p;
-					drivers_.erase(tmp);
+					removed.push_back(p->second);
+					d->loading.erase(p->first);
+					d->owners.erase(p++);
 				}
 				else {
+					updated->insert(std::make_pair(p->first,p->second.get()));
 					++p;
 				}
 			}
+			if(!removed.empty())
+				d->publish(updated.release());
 		}
-		garbage.clear();
+		removed.clear();
 	}
 
 	#if defined(WIN32) || defined(_WIN32) || defined(__WIN32) || defined(__CYGWIN__)
@@ -176,7 +261,13 @@ namespace cppdb {
 	{
 		std::vector<std::string> so_names;
 		std::string module;
-		std::vector<std::string> search_paths = search_paths_;
+		std::vector<std::string> search_paths;
+		bool no_default_directory;
+		{
+			mutex::guard l(lock_);
+			search_paths = search_paths_;
+			no_default_directory = no_default_directory_;
+		}
 		std::string mpath=conn.get("@modules_path");
 		if(!mpath.empty()) {
 			size_t sep = mpath.find(PATH_SEPARATOR);
@@ -199,7 +290,7 @@ namespace cppdb {
 				so_names.push_back(search_paths[i]+"/" + so_name1);
 				so_names.push_back(search_paths[i]+"/" + so_name2);
 			}
-			if(!no_default_directory_) {
+			if(!no_default_directory) {
 				so_names.push_back(so_name1);
 				so_names.push_back(so_name2);
 			}
@@ -210,19 +301,32 @@ namespace cppdb {
 
 	ref_ptr<backend::driver> driver_manager::install_driver(std::string const &name,ref_ptr<backend::driver> drv, bool force)
 	{
-		if (!force && drivers_.count(name)) {
-			return drivers_[name];
+		if(!force) {
+			ref_ptr<backend::driver> existing = d->find(name);
+			if(existing)
+				return existing;
 		}
 		if(!drv) {
 			throw cppdb_error("cppdb::driver_manager::install_driver: Can't install empty driver");
 		}
-		// minimalize the need to lock
+		// released after unlocking as it may unload a module
+		ref_ptr<backend::driver> replaced;
 		mutex::guard lock(lock_);
-		drivers_[name]=drv;
+		data::owners_type::iterator p = d->owners.find(name);
+		if(p != d->owners.end()) {
+			if(!force)
+				return p->second;
+			replaced = p->second;
+		}
+		std::unique_ptr<data::drivers_type> updated(new data::drivers_type(*d->snapshot()));
+		(*updated)[name]=drv.get();
+		d->owners[name]=drv;
+		d->publish(updated.release());
 		return drv;
 	}
 
 	driver_manager::driver_manager() : 
+		d(new data()),
 		no_default_directory_(false)
 	{
 	}
@@ -21,6 +21,14 @@
 #include <cppdb/conn_manager.h>
 #include <cppdb/pool.h>
 
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
 namespace cppdb {
 	struct result::data {};
 
@@ -43,6 +51,80 @@ namespace cppdb {
 		backend::connection *conn_;
 	};
 
+	namespace {
+		//
+		// Bounded pool of worker threads executing the statements of the backends that
+		// do not support asynchronous execution
+		//
+		class async_executor {
+		public:
+			static async_executor &instance()
+			{
+				static async_executor executor;
+				return executor;
+			}
+			template<typename R>
+			std::future<R> submit(std::function<R()> const &f)
+			{
+				std::shared_ptr<std::packaged_task<R()> > task(new std::packaged_task<R()>(f));
+				std::future<R> r = task->get_future();
+				{
+					std::unique_lock<std::mutex> g(lock_);
+					if(workers_.size() < max_workers_ && idle_ == 0)
+						workers_.push_back(std::thread(&async_executor::run,this));
+					tasks_.push_back([task]() { (*task)(); });
+				}
+				cond_.notify_one();
+				return r;
+			}
+		private:
+			async_executor() :
+				max_workers_(std::max(2u,std::thread::hardware_concurrency())),
+				idle_(0),
+				stop_(false)
+			{
+			}
+			~async_executor()
+			{
+				{
+					std::unique_lock<std::mutex> g(lock_);
+					stop_ = true;
+				}
+				cond_.notify_all();
+				for(unsigned i=0;i<workers_.size();i++)
+					workers_[i].join();
+			}
+			void run()
+			{
+				std::unique_lock<std::mutex> g(lock_);
+				for(;;) {
+					if(tasks_.empty()) {
+						if(stop_)
+							return;
+						idle_++;
+						cond_.wait(g);
+						idle_--;
+						continue;
+					}
+					std::function<void()> task;
+					task.swap(tasks_.front());
+					tasks_.pop_front();
+					g.unlock();
+					task();
+					g.lock();
+				}
+			}
+
+			size_t max_workers_;
+			size_t idle_;
+			bool stop_;
+			std::mutex lock_;
+			std::condition_variable cond_;
+			std::deque<std::function<void()> > tasks_;
+			std::vector<std::thread> workers_;
+		};
+	}
+
 	result::result() :
 		eof_(false),
 		fetched_(false),
@@ -102,6 +184,16 @@ namespace cppdb {
 		current_col_ = 0;
 		return !eof_;
 	}
+	bool result::next_result()
+	{
+		throw_guard g(conn_);
+
+		bool has_result = res_->next_result();
+		eof_ = !has_result;
+		fetched_ = false;
+		current_col_ = 0;
+		return has_result;
+	}
 	
 	int result::index(std::string const &n)
 	{
@@ -117,6 +209,12 @@ namespace cppdb {
 			throw invalid_column();
 		return res_->column_to_name(col);
 	}
+	std::string result::declared_type(int col)
+	{
+		if(col < 0 || col>= cols())
+			throw invalid_column();
+		return res_->declared_type(col);
+	}
 
 	int result::find_column(std::string const &name)
 	{
@@ -181,6 +279,8 @@ namespace cppdb {
 	bool result::fetch(int col,long double &v) { return res_->fetch(col,v); }
 	bool result::fetch(int col,std::string &v) { return res_->fetch(col,v); }
 	bool result::fetch(int col,std::tm &v) { return res_->fetch(col,v); }
+	bool result::fetch(int col,sys_microseconds &v) { return res_->fetch(col,v); }
+	bool result::fetch(int col,decimal &v) { return res_->fetch(col,v); }
 	bool result::fetch(int col,std::ostream &v) { return res_->fetch(col,v); }
 
 	bool result::fetch(std::string const &n,short &v) { return res_->fetch(index(n),v); }
@@ -196,6 +296,8 @@ namespace cppdb {
 	bool result::fetch(std::string const &n,long double &v) { return res_->fetch(index(n),v); }
 	bool result::fetch(std::string const &n,std::string &v) { return res_->fetch(index(n),v); }
 	bool result::fetch(std::string const &n,std::tm &v) { return res_->fetch(index(n),v); }
+	bool result::fetch(std::string const &n,sys_microseconds &v) { return res_->fetch(index(n),v); }
+	bool result::fetch(std::string const &n,decimal &v) { return res_->fetch(index(n),v); }
 	bool result::fetch(std::string const &n,std::ostream &v) { return res_->fetch(index(n),v); }
 
 	bool result::fetch(short &v) { return res_->fetch(current_col_++,v); }
@@ -211,6 +313,8 @@ namespace cppdb {
 	bool result::fetch(long double &v) { return res_->fetch(current_col_++,v); }
 	bool result::fetch(std::string &v) { return res_->fetch(current_col_++,v); }
 	bool result::fetch(std::tm &v) { return res_->fetch(current_col_++,v); }
+	bool result::fetch(sys_microseconds &v) { return res_->fetch(current_col_++,v); }
+	bool result::fetch(decimal &v) { return res_->fetch(current_col_++,v); }
 	bool result::fetch(std::ostream &v) { return res_->fetch(current_col_++,v); }
 
 
@@ -276,6 +380,14 @@ namespace cppdb {
 	{
 		return bind(v);
 	}
+	statement &statement::operator<<(sys_microseconds const &v)
+	{
+		return bind(v);
+	}
+	statement &statement::operator<<(decimal const &v)
+	{
+		return bind(v);
+	}
 	
 	statement &statement::operator<<(std::istream &v)
 	{
@@ -353,6 +465,16 @@ namespace cppdb {
 		stat_->bind(placeholder_++,v);
 		return *this;
 	}
+	statement &statement::bind(sys_microseconds const &v)
+	{
+		stat_->bind(placeholder_++,v);
+		return *this;
+	}
+	statement &statement::bind(decimal const &v)
+	{
+		stat_->bind(placeholder_++,v);
+		return *this;
+	}
 	statement &statement::bind(std::istream &v)
 	{
 		stat_->bind(placeholder_++,v);
@@ -381,6 +503,14 @@ namespace cppdb {
 	{
 		stat_->bind(col,v);
 	}
+	void statement::bind(int col,sys_microseconds const &v)
+	{
+		stat_->bind(col,v);
+	}
+	void statement::bind(int col,decimal const &v)
+	{
+		stat_->bind(col,v);
+	}
 	void statement::bind(int col,std::istream &v)
 	{
 		stat_->bind(col,v);
@@ -468,6 +598,62 @@ namespace cppdb {
 		throw_guard g(conn_);
 		stat_->exec();
 	}
+	result statement::exec_returning(std::vector<std::string> const &columns)
+	{
+		throw_guard g(conn_);
+		ref_ptr<backend::result> res(stat_->exec_returning(columns));
+		return result(res,stat_,conn_);
+	}
+	bool statement::start()
+	{
+		throw_guard g(conn_);
+		return stat_->start_async();
+	}
+	bool statement::ready()
+	{
+		throw_guard g(conn_);
+		return stat_->poll_async();
+	}
+	//
+	// The copy of the statement held by the task is released before the result is published,
+	// otherwise it could be returned to the statements cache by the worker thread while the
+	// caller already uses the session
+	//
+	std::future<result> statement::async_query()
+	{
+		statement self(*this);
+		std::function<result()> f = [self]() mutable {
+			try {
+				result r = self.query();
+				self.clear();
+				return r;
+			}
+			catch(...) {
+				self.clear();
+				throw;
+			}
+		};
+		if(start())
+			return std::async(std::launch::deferred,f);
+		return async_executor::instance().submit(f);
+	}
+	std::future<void> statement::async_exec()
+	{
+		statement self(*this);
+		std::function<void()> f = [self]() mutable {
+			try {
+				self.exec();
+			}
+			catch(...) {
+				self.clear();
+				throw;
+			}
+			self.clear();
+		};
+		if(start())
+			return std::async(std::launch::deferred,f);
+		return async_executor::instance().submit(f);
+	}
 
 	struct session::data {};
 
@@ -687,6 +873,19 @@ namespace cppdb {
 	{
 		conn_->connection_specific_reset(t,p);
 	}
+	void *session::get_extension(std::type_info const &t)
+	{
+		return conn_->get_extension(t);
+	}
+	bool session::poll()
+	{
+		throw_guard g(conn_);
+		return conn_->poll_async();
+	}
+	int session::async_socket()
+	{
+		return conn_->async_socket();
+	}
 
 	char const *version_string()
 	{
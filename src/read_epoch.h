@@ -0,0 +1,97 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//  Copyright (C) 2020  Alex Bodnaru <alexbodn@gmail.com>
+//
+//  Distributed under:
+//
+//                   the Boost Software License, Version 1.0.
+//              (See accompanying file LICENSE_1_0.txt or copy at
+//                     http://www.boost.org/LICENSE_1_0.txt)
+//
+//  or (at your opinion) under:
+//
+//                               The MIT License
+//                 (See accompanying file MIT.txt or a copy at
+//              http://www.opensource.org/licenses/mit-license.php)
+//
+///////////////////////////////////////////////////////////////////////////////
+#ifndef CPPDB_READ_EPOCH_H
+#define CPPDB_READ_EPOCH_H
+
+#include <atomic>
+#include <thread>
+#include <functional>
+
+namespace cppdb {
+	namespace details {
+
+		//
+		// Tracks the readers of data published through an atomic pointer, so a writer knows
+		// when a replaced object can no longer be used and may be freed.
+		//
+		// A reader holds a guard while it uses the object. The readers are counted in one of two
+		// epochs, spread over several cache lines by their thread. synchronize() switches the epoch
+		// and waits for the readers of the previous one, the new readers are counted in the other
+		// epoch so the wait ends once the lookups in progress are done, whatever the reader traffic is.
+		//
+		class read_epoch {
+		public:
+			class guard {
+			public:
+				guard(read_epoch &e) : counter_(e.enter())
+				{
+				}
+				~guard()
+				{
+					counter_->fetch_sub(1,std::memory_order_release);
+				}
+			private:
+				guard(guard const &);
+				void operator=(guard const &);
+				std::atomic<long> *counter_;
+			};
+
+			read_epoch() : epoch_(0)
+			{
+				for(int i=0;i<slots;i++) {
+					slots_[i].readers[0].store(0,std::memory_order_relaxed);
+					slots_[i].readers[1].store(0,std::memory_order_relaxed);
+				}
+			}
+			//
+			// Wait until the readers that could see an object replaced before the call are done,
+			// the calls should be serialized by the writers' lock
+			//
+			void synchronize()
+			{
+				// a reader may read the epoch just before the switch and be counted after it,
+				// waiting for both epochs in turn covers it
+				for(int pass=0;pass<2;pass++) {
+					unsigned prev = epoch_.fetch_add(1) & 1;
+					for(int i=0;i<slots;i++) {
+						while(slots_[i].readers[prev].load() != 0)
+							std::this_thread::yield();
+					}
+				}
+			}
+		private:
+			static const int slots = 16;
+			struct alignas(64) slot {
+				std::atomic<long> readers[2];
+			};
+			std::atomic<long> *enter()
+			{
+				static thread_local unsigned index = std::hash<std::thread::id>()(std::this_thread::get_id()) % slots;
+				std::atomic<long> *counter = &slots_[index].readers[epoch_.load() & 1];
+				counter->fetch_add(1);
+				return counter;
+			}
+
+			slot slots_[slots];
+			std::atomic<unsigned> epoch_;
+		};
+
+	} // details
+} // cppdb
+
+#endif
@@ -18,114 +18,514 @@
 #define CPPDB_SOURCE
 #include <cppdb/utils.h>
 #include <cppdb/errors.h>
+#include <cppdb/mutex.h>
+#include <cppdb/numeric_util.h>
 #include <time.h>
 #include <stdio.h>
 #include <string.h>
 #include <sstream>
-#include <regex>
+#include <memory>
 #include <locale>
 
 #include <iostream>
 
 namespace cppdb {
+	namespace {
+		bool is_blank_char(char c)
+		{
+			return c==' ' || c=='\t' || c=='\r' || c=='\n' || c=='\f';
+		}
+	}
+
+	namespace {
+		//
+		// Civil calendar arithmetic, see http://howardhinnant.github.io/date_algorithms.html
+		//
+		long long days_from_civil(long long y,unsigned m,unsigned d)
+		{
+			y -= m <= 2;
+			long long era = (y >= 0 ? y : y - 399) / 400;
+			unsigned yoe = static_cast<unsigned>(y - era * 400);
+			unsigned doy = (153 * (m > 2 ? m - 3 : m + 9) + 2) / 5 + d - 1;
+			unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+			return era * 146097 + static_cast<long long>(doe) - 719468;
+		}
+		void civil_from_days(long long z,long long &y,unsigned &m,unsigned &d)
+		{
+			z += 719468;
+			long long era = (z >= 0 ? z : z - 146096) / 146097;
+			unsigned doe = static_cast<unsigned>(z - era * 146097);
+			unsigned yoe = (doe - doe/1460 + doe/36524 - doe/146096) / 365;
+			unsigned doy = doe - (365*yoe + yoe/4 - yoe/100);
+			unsigned mp = (5*doy + 2)/153;
+			d = doy - (153*mp+2)/5 + 1;
+			m = mp < 10 ? mp+3 : mp-9;
+			y = static_cast<long long>(yoe) + era * 400 + (m <= 2);
+		}
+		unsigned days_in_month(long long y,unsigned m)
+		{
+			static const unsigned char days[12] = { 31,28,31,30,31,30,31,31,30,31,30,31 };
+			if(m == 2 && y % 4 == 0 && (y % 100 != 0 || y % 400 == 0))
+				return 29;
+			return days[m-1];
+		}
+
+		struct datetime_fields {
+			datetime_fields() :
+				has_date(false),has_time(false),
+				year(0),month(0),day(0),
+				hour(0),minute(0),second(0),microsecond(0),
+				offset(0)
+			{
+			}
+			bool has_date;
+			bool has_time;
+			int year,month,day;
+			int hour,minute,second,microsecond;
+			int offset; // seconds east of UTC
+		};
+
+		class datetime_parser {
+		public:
+			datetime_parser(char const *b,char const *e) : p_(b), e_(e)
+			{
+				while(p_ != e_ && is_space(*p_))
+					p_++;
+				while(e_ != p_ && is_space(e_[-1]))
+					e_--;
+			}
+			void parse(datetime_fields &f)
+			{
+				int first;
+				char const *start = p_;
+				number(1,9,first);
+				if(p_ != e_ && *p_ == '-') {
+					f.has_date = true;
+					f.year = first;
+					p_++;
+					number(1,2,f.month);
+					expect('-');
+					number(1,2,f.day);
+					if(f.month < 1 || f.month > 12 || f.day < 1 || unsigned(f.day) > days_in_month(f.year,f.month))
+						throw bad_value_cast();
+					if(p_ == e_)
+						return;
+					if(*p_ != ' ' && *p_ != 'T' && *p_ != 't')
+						throw bad_value_cast();
+					p_++;
+					number(1,2,f.hour);
+				}
+				else {
+					if(p_ - start > 2)
+						throw bad_value_cast();
+					f.hour = first;
+				}
+				f.has_time = true;
+				expect(':');
+				number(1,2,f.minute);
+				if(p_ != e_ && *p_ == ':') {
+					p_++;
+					number(1,2,f.second);
+					if(p_ != e_ && (*p_ == '.' || *p_ == ',')) {
+						p_++;
+						fraction(f.microsecond);
+					}
+				}
+				if(f.hour > 23 || f.minute > 59 || f.second > 60)
+					throw bad_value_cast();
+				if(p_ != e_)
+					offset(f.offset);
+				if(p_ != e_)
+					throw bad_value_cast();
+			}
+		private:
+			static bool is_space(char c)
+			{
+				return c==' ' || ('\t' <= c && c <= '\r');
+			}
+			static bool is_digit(char c)
+			{
+				return '0' <= c && c <= '9';
+			}
+			void expect(char c)
+			{
+				if(p_ == e_ || *p_ != c)
+					throw bad_value_cast();
+				p_++;
+			}
+			void number(int min_digits,int max_digits,int &v)
+			{
+				v = 0;
+				int n = 0;
+				while(p_ != e_ && is_digit(*p_) && n < max_digits) {
+					v = v * 10 + (*p_++ - '0');
+					n++;
+				}
+				if(n < min_digits)
+					throw bad_value_cast();
+			}
+			void fraction(int &v)
+			{
+				v = 0;
+				int n = 0;
+				for(;p_ != e_ && is_digit(*p_);p_++,n++) {
+					if(n < 6)
+						v = v * 10 + (*p_ - '0');
+				}
+				if(n == 0)
+					throw bad_value_cast();
+				for(;n < 6;n++)
+					v *= 10;
+			}
+			void offset(int &v)
+			{
+				if(*p_ == 'Z' || *p_ == 'z') {
+					p_++;
+					v = 0;
+					return;
+				}
+				if(*p_ == ' ' && e_ - p_ > 1 && (p_[1] == '+' || p_[1] == '-'))
+					p_++;
+				if(*p_ != '+' && *p_ != '-')
+					throw bad_value_cast();
+				int sign = *p_++ == '-' ? -1 : 1;
+				int h = 0,m = 0;
+				number(2,2,h);
+				if(p_ != e_ && *p_ == ':')
+					p_++;
+				if(p_ != e_)
+					number(2,2,m);
+				if(h > 23 || m > 59)
+					throw bad_value_cast();
+				v = sign * (h * 3600 + m * 60);
+			}
+
+			char const *p_;
+			char const *e_;
+		};
+
+		void set_date(std::tm &t,long long days)
+		{
+			long long y;
+			unsigned m,d;
+			civil_from_days(days,y,m,d);
+			t.tm_year = static_cast<int>(y - 1900);
+			t.tm_mon = m - 1;
+			t.tm_mday = d;
+			t.tm_yday = static_cast<int>(days - days_from_civil(y,1,1));
+			t.tm_wday = static_cast<int>(((days % 7) + 11) % 7); // 1970-01-01 is Thursday
+		}
+
+		std::tm to_tm(datetime_fields const &f)
+		{
+			std::tm t=std::tm();
+			if(f.has_date)
+				set_date(t,days_from_civil(f.year,f.month,f.day));
+			else
+				set_date(t,days_from_civil(1899,12,31)); // day 0 of 1900 as normalized by mktime
+			t.tm_hour = f.hour;
+			t.tm_min = f.minute;
+			t.tm_sec = f.second;
+			t.tm_isdst = -1;
+			return t;
+		}
+
+		char *write_digits(char *buf,long long v,int width)
+		{
+			if(v < 0) {
+				*buf++ = '-';
+				v = -v;
+			}
+			char tmp[20];
+			int n = 0;
+			do {
+				tmp[n++] = static_cast<char>('0' + v % 10);
+				v /= 10;
+			} while(v);
+			for(;width > n;width--)
+				*buf++ = '0';
+			while(n > 0)
+				*buf++ = tmp[--n];
+			return buf;
+		}
+		char *write_date(char *buf,long long year,int mon,int mday)
+		{
+			buf = write_digits(buf,year,4);
+			*buf++ = '-';
+			buf = write_digits(buf,mon,2);
+			*buf++ = '-';
+			return write_digits(buf,mday,2);
+		}
+		char *write_time(char *buf,int hour,int min,int sec)
+		{
+			buf = write_digits(buf,hour,2);
+			*buf++ = ':';
+			buf = write_digits(buf,min,2);
+			*buf++ = ':';
+			return write_digits(buf,sec,2);
+		}
+	}
+
+	char *format_date(char *buf,std::tm const &v)
+	{
+		return write_date(buf,v.tm_year + 1900LL,v.tm_mon + 1,v.tm_mday);
+	}
+	char *format_time(char *buf,std::tm const &v)
+	{
+		return write_time(buf,v.tm_hour,v.tm_min,v.tm_sec);
+	}
+	char *format_datetime(char *buf,std::tm const &v)
+	{
+		buf = format_date(buf,v);
+		*buf++ = ' ';
+		return format_time(buf,v);
+	}
 	std::string format_date(std::tm const &v)
 	{
-		char buf[11]= {0};
-		strftime(buf,sizeof(buf),"%Y-%m-%d",&v);
-		return std::string(buf);
+		char buf[datetime_buffer_size];
+		return std::string(buf,format_date(buf,v));
 	}
 	std::string format_time(std::tm const &v)
 	{
-		char buf[20]= {0};
-		strftime(buf,sizeof(buf),"%H:%M:%S",&v);
-		return std::string(buf);
+		char buf[datetime_buffer_size];
+		return std::string(buf,format_time(buf,v));
 	}
 	std::string format_datetime(std::tm const &v)
 	{
-		char buf[64]= {0};
-		strftime(buf,sizeof(buf),"%Y-%m-%d %H:%M:%S",&v);
-		return std::string(buf);
+		char buf[datetime_buffer_size];
+		return std::string(buf,format_datetime(buf,v));
 	}
 
-	std::tm parse_date(std::string const &v)
+	std::tm parse_date(char const *b,char const *e)
 	{
-		if(strlen(v.c_str())!=v.size())
+		datetime_fields f;
+		datetime_parser(b,e).parse(f);
+		if(!f.has_date)
 			throw bad_value_cast();
-		return parse_date(v.c_str());
+		std::tm t = to_tm(f);
+		t.tm_hour = t.tm_min = t.tm_sec = 0;
+		return t;
 	}
-	std::tm parse_date(char const *v)
+	std::tm parse_time(char const *b,char const *e)
 	{
-		std::tm t=std::tm();
-		int n;
-		n = sscanf(v,"%d-%d-%d",
-			&t.tm_year,&t.tm_mon,&t.tm_mday);
-		if(n!=3) 
-		{
-			throw bad_value_cast();
-		}
-		t.tm_year-=1900;
-		t.tm_mon-=1;
-		t.tm_isdst = -1;
-		if(mktime(&t)==-1)
+		datetime_fields f;
+		datetime_parser(b,e).parse(f);
+		if(f.has_date)
 			throw bad_value_cast();
-		return t;
+		return to_tm(f);
+	}
+	std::tm parse_datetime(char const *b,char const *e)
+	{
+		datetime_fields f;
+		datetime_parser(b,e).parse(f);
+		return to_tm(f);
+	}
+	std::tm parse_date(std::string const &v)
+	{
+		return parse_date(v.c_str(),v.c_str()+v.size());
+	}
+	std::tm parse_date(char const *v)
+	{
+		return parse_date(v,v+strlen(v));
 	}
 	std::tm parse_time(std::string const &v)
 	{
-		if(strlen(v.c_str())!=v.size())
-			throw bad_value_cast();
-		return parse_time(v.c_str());
+		return parse_time(v.c_str(),v.c_str()+v.size());
 	}
 	std::tm parse_time(char const *v)
 	{
-		std::tm t=std::tm();
-		int n;
-		double sec = 0;
-		n = sscanf(v,"%d:%d:%lf",
-			&t.tm_hour,&t.tm_min,&sec);
-		if(n!=3) 
-		{
-			throw bad_value_cast();
-		}
-		t.tm_isdst = -1;
-		t.tm_sec=static_cast<int>(sec);
-		if(mktime(&t)==-1)
-			throw bad_value_cast();
-		return t;
+		return parse_time(v,v+strlen(v));
 	}
 	std::tm parse_datetime(std::string const &v)
 	{
-		if(strlen(v.c_str())!=v.size())
-			throw bad_value_cast();
-		return parse_datetime(v.c_str());
+		return parse_datetime(v.c_str(),v.c_str()+v.size());
 	}
 	std::tm parse_datetime(char const *v)
 	{
-		std::tm t=std::tm();
-		int n;
-		double sec = 0;
-		n = sscanf(v,"%d-%d-%d %d:%d:%lf",
-			&t.tm_year,&t.tm_mon,&t.tm_mday,
-			&t.tm_hour,&t.tm_min,&sec);
-		if(n!=3 && n!=6) 
-		{
-			return parse_time(v);
+		return parse_datetime(v,v+strlen(v));
+	}
+
+	sys_microseconds parse_timestamp(char const *b,char const *e)
+	{
+		datetime_fields f;
+		datetime_parser(b,e).parse(f);
+		if(!f.has_date)
+			throw bad_value_cast();
+		long long days = days_from_civil(f.year,f.month,f.day);
+		long long seconds = days * 86400 + f.hour * 3600 + f.minute * 60 + f.second - f.offset;
+		return sys_microseconds(std::chrono::microseconds(seconds * 1000000 + f.microsecond));
+	}
+	sys_microseconds parse_timestamp(std::string const &v)
+	{
+		return parse_timestamp(v.c_str(),v.c_str()+v.size());
+	}
+	char *format_timestamp(char *buf,sys_microseconds v)
+	{
+		long long us = v.time_since_epoch().count();
+		long long days = us / 86400000000LL;
+		long long rest = us % 86400000000LL;
+		if(rest < 0) {
+			rest += 86400000000LL;
+			days--;
+		}
+		long long y;
+		unsigned m,d;
+		civil_from_days(days,y,m,d);
+		int micro = static_cast<int>(rest % 1000000);
+		int sec = static_cast<int>(rest / 1000000);
+		buf = write_date(buf,y,m,d);
+		*buf++ = ' ';
+		buf = write_time(buf,sec / 3600,sec / 60 % 60,sec % 60);
+		if(micro != 0) {
+			*buf++ = '.';
+			buf = write_digits(buf,micro,6);
+		}
+		return buf;
+	}
+	std::string format_timestamp(sys_microseconds v)
+	{
+		char buf[datetime_buffer_size];
+		return std::string(buf,format_timestamp(buf,v));
+	}
+	sys_microseconds make_timestamp(int year,int month,int day,int hour,int minute,int second,int microsecond)
+	{
+		long long days = days_from_civil(year,month,day);
+		long long seconds = days * 86400 + hour * 3600 + minute * 60 + second;
+		return sys_microseconds(std::chrono::microseconds(seconds * 1000000 + microsecond));
+	}
+	std::tm timestamp_to_tm(sys_microseconds v)
+	{
+		long long us = v.time_since_epoch().count();
+		long long days = us / 86400000000LL;
+		long long rest = us % 86400000000LL;
+		if(rest < 0) {
+			rest += 86400000000LL;
+			days--;
 		}
-		t.tm_year-=1900;
-		t.tm_mon-=1;
+		std::tm t=std::tm();
+		set_date(t,days);
+		int sec = static_cast<int>(rest / 1000000);
+		t.tm_hour = sec / 3600;
+		t.tm_min = sec / 60 % 60;
+		t.tm_sec = sec % 60;
 		t.tm_isdst = -1;
-		t.tm_sec=static_cast<int>(sec);
-		if(mktime(&t)==-1)
-			throw bad_value_cast();
 		return t;
 	}
 
 	namespace {
-		bool is_blank_char(char c)
+		//
+		// Unsigned 128 bit arithmetic on a pair of 64 bit integers
+		//
+		struct uint128 {
+			unsigned long long high;
+			unsigned long long low;
+		};
+		bool mul10_add(uint128 &v,unsigned digit)
 		{
-			return c==' ' || c=='\t' || c=='\r' || c=='\n' || c=='\f';
+			unsigned long long const mask = 0xFFFFFFFFULL;
+			unsigned long long p0 = (v.low & mask) * 10 + digit;
+			unsigned long long p1 = (v.low >> 32) * 10 + (p0 >> 32);
+			unsigned long long carry = p1 >> 32;
+			if(v.high > (~0ULL - carry) / 10)
+				return false;
+			v.low = (p0 & mask) | (p1 << 32);
+			v.high = v.high * 10 + carry;
+			return true;
+		}
+		unsigned div10(uint128 &v)
+		{
+			unsigned long long const mask = 0xFFFFFFFFULL;
+			unsigned long long r = v.high % 10;
+			v.high /= 10;
+			unsigned long long t = (r << 32) | (v.low >> 32);
+			unsigned long long q1 = t / 10;
+			t = ((t % 10) << 32) | (v.low & mask);
+			unsigned long long q0 = t / 10;
+			v.low = (q1 << 32) | q0;
+			return static_cast<unsigned>(t % 10);
+		}
+		void negate(uint128 &v)
+		{
+			v.low = ~v.low + 1;
+			v.high = ~v.high + (v.low == 0 ? 1 : 0);
+		}
+	}
+
+	decimal parse_decimal(char const *b,char const *e)
+	{
+		while(b != e && is_blank_char(*b))
+			b++;
+		while(e != b && is_blank_char(e[-1]))
+			e--;
+		bool neg = false;
+		if(b != e && (*b == '-' || *b == '+')) {
+			neg = *b == '-';
+			b++;
+		}
+		uint128 v = { 0, 0 };
+		int digits = 0;
+		int scale = 0;
+		bool point = false;
+		for(;b != e;b++) {
+			if(*b == '.' && !point) {
+				point = true;
+				continue;
+			}
+			if(*b < '0' || '9' < *b)
+				throw bad_value_cast();
+			if(!mul10_add(v,*b - '0'))
+				throw bad_value_cast();
+			digits++;
+			if(point)
+				scale++;
+		}
+		if(digits == 0 || scale > 38)
+			throw bad_value_cast();
+		// the magnitude should fit the signed 128 bit range
+		unsigned long long const sign_bit = 1ULL << 63;
+		if(v.high > sign_bit || (v.high == sign_bit && (v.low != 0 || !neg)))
+			throw bad_value_cast();
+		if(neg)
+			negate(v);
+		decimal r;
+		r.high = static_cast<long long>(v.high);
+		r.low = v.low;
+		r.scale = scale;
+		return r;
+	}
+	decimal parse_decimal(std::string const &v)
+	{
+		return parse_decimal(v.c_str(),v.c_str()+v.size());
+	}
+	char *format_decimal(char *buf,decimal const &v)
+	{
+		if(v.scale < 0 || v.scale > 38)
+			throw bad_value_cast();
+		uint128 u = { static_cast<unsigned long long>(v.high), v.low };
+		if(v.high < 0) {
+			*buf++ = '-';
+			negate(u);
+		}
+		char tmp[48];
+		int n = 0;
+		do {
+			tmp[n++] = static_cast<char>('0' + div10(u));
+		} while(u.high != 0 || u.low != 0);
+		while(n <= v.scale)
+			tmp[n++] = '0';
+		while(n > 0) {
+			if(n == v.scale)
+				*buf++ = '.';
+			*buf++ = tmp[--n];
 		}
+		return buf;
 	}
+	std::string format_decimal(decimal const &v)
+	{
+		char buf[datetime_buffer_size];
+		return std::string(buf,format_decimal(buf,v));
+	}
+
 		std::string str_trim(std::string const &s)
 		{
 			if(s.empty())
@@ -235,16 +635,77 @@ namespace cppdb {
 		return input;
 	}
 
+	namespace {
+		//
+		// Find the first placeholder in [p,e): an unescaped '%', flags, "(name)" and a lower case letter.
+		// Returns the position of its '%' and sets [name_b,name_e) and its end, returns e if not found
+		//
+		char const *next_placeholder(char const *p,char const *e,char const *&name_b,char const *&name_e,char const *&end)
+		{
+			while(p < e) {
+				if(*p != '%') {
+					++p;
+					continue;
+				}
+				char const *run = p;
+				while(p < e && *p == '%')
+					++p;
+				if((p - run) % 2 == 0)
+					continue;
+				char const *q = p;
+				while(q < e && *q != '(' && *q != '%')
+					++q;
+				if(q == e || *q != '(')
+					continue;
+				char const *nb = ++q;
+				while(q < e && *q != ')' && *q != '(' && *q != '%')
+					++q;
+				if(q + 1 >= e || *q != ')' || q[1] < 'a' || 'z' < q[1])
+					continue;
+				name_b = nb;
+				name_e = q;
+				end = q + 2;
+				return p - 1;
+			}
+			return e;
+		}
+		void append_unescaped(std::string &out,char const *b,char const *e)
+		{
+			while(b < e) {
+				char const *p = static_cast<char const *>(memchr(b,'%',e-b));
+				if(!p || p + 1 >= e) {
+					out.append(b,e-b);
+					return;
+				}
+				out.append(b,p+1-b);
+				b = p[1] == '%' ? p + 2 : p + 1;
+			}
+		}
+	}
+
 	std::string str_replace_format(
 		std::string const &sHaystack, std::string const &sNeedle, 
 		std::string const &sReplace, 
 		std::string (*formater)(std::string const &))
 	{
-		std::string sre = "(^|[^%])((%%){0,})[%]{1}([^(%]{0,})\\(" + sNeedle + "\\)([a-z])";
-		std::regex re(sre);
-		std::string replace = "$1$2" + str_replace(
-			formater ? formater(sReplace) : sReplace, "$", "$$", 0);
-		return std::regex_replace(sHaystack, re, replace);
+		std::string value = formater ? formater(sReplace) : sReplace;
+		std::string out;
+		out.reserve(sHaystack.size());
+		char const *p = sHaystack.c_str();
+		char const *e = p + sHaystack.size();
+		while(p < e) {
+			char const *name_b,*name_e,*end;
+			char const *start = next_placeholder(p,e,name_b,name_e,end);
+			out.append(p,start-p);
+			if(start == e)
+				break;
+			if(sNeedle.compare(0,sNeedle.size(),name_b,name_e-name_b) == 0)
+				out += value;
+			else
+				out.append(start,end-start);
+			p = end;
+		}
+		return out;
 	}
 
 	std::string str_join(std::vector<std::string> const &strings, std::string const &delim)
@@ -309,15 +770,12 @@ namespace cppdb {
 		properties_type::const_iterator p=properties_.find(prop);
 		if(p==properties_.end())
 			return default_value;
-		std::istringstream ss;
-		ss.imbue(std::locale::classic());
-		ss.str(p->second);
-		int val;
-		ss >> val;
-		if(!ss || !ss.eof()) {
+		try {
+			return parse_number<int>(p->second.c_str(),p->second.c_str()+p->second.size());
+		}
+		catch(bad_value_cast const &) {
 			throw cppdb_error("cppdb::properties property " + prop + " expected to be integer value");
 		}
-		return val;
 	}
 
 	void properties::set(std::string const &key, std::string const &value)
@@ -344,14 +802,124 @@ namespace cppdb {
 		return str + "\n}";
 	}
 
+	namespace {
+		//
+		// The templates compiled by properties::format(), they come from the dialects and the
+		// schema renderer so there are few, the cache is dropped if it ever grows too much
+		//
+		struct template_cache {
+			static const size_t max_size = 512;
+			mutex lock;
+			std::map<std::string,std::shared_ptr<format_template const> > templates;
+		};
+		template_cache &get_template_cache()
+		{
+			static template_cache cache;
+			return cache;
+		}
+	}
+
 	std::string properties::format(std::string const &fmt, std::string (*formater)(std::string const &)) const
 	{
-		properties_type::const_iterator p;
-		std::string fmtp = fmt;
-		for (p=properties_.begin();p!=properties_.end();p++) {
-			fmtp = str_replace_format(fmtp, p->first, p->second, formater);
+		template_cache &cache = get_template_cache();
+		std::shared_ptr<format_template const> t;
+		{
+			mutex::guard g(cache.lock);
+			std::map<std::string,std::shared_ptr<format_template const> >::const_iterator p = cache.templates.find(fmt);
+			if(p != cache.templates.end())
+				t = p->second;
+		}
+		if(!t) {
+			t = std::make_shared<format_template const>(fmt);
+			mutex::guard g(cache.lock);
+			if(cache.templates.size() >= template_cache::max_size)
+				cache.templates.clear();
+			cache.templates[fmt] = t;
+		}
+		return t->render(*this,formater);
+	}
+
+	format_template::format_template() :
+		literal_size_(0),
+		placeholders_(0)
+	{
+	}
+
+	format_template::format_template(std::string const &fmt) :
+		literal_size_(0),
+		placeholders_(0)
+	{
+		char const *p = fmt.c_str();
+		char const *e = p + fmt.size();
+		while(p < e) {
+			char const *name_b,*name_e,*end;
+			char const *start = next_placeholder(p,e,name_b,name_e,end);
+			if(start != p) {
+				segment lit;
+				lit.placeholder = false;
+				append_unescaped(lit.text,p,start);
+				literal_size_ += lit.text.size();
+				segments_.push_back(lit);
+			}
+			if(start == e)
+				break;
+			segment ph;
+			ph.placeholder = true;
+			ph.text.assign(name_b,name_e);
+			ph.raw.assign(start,end);
+			segments_.push_back(ph);
+			placeholders_++;
+			p = end;
+		}
+	}
+
+	size_t format_template::placeholders() const
+	{
+		return placeholders_;
+	}
+
+	std::string format_template::render(properties const &props, std::string (*formater)(std::string const &)) const
+	{
+		properties::properties_type const &values = props.properties_;
+		std::vector<std::string> formatted;
+		if(formater)
+			formatted.reserve(placeholders_);
+		size_t size = literal_size_;
+		for(size_t i=0;i<segments_.size();i++) {
+			segment const &s = segments_[i];
+			if(!s.placeholder)
+				continue;
+			properties::properties_type::const_iterator v = values.find(s.text);
+			if(v == values.end()) {
+				size += s.raw.size();
+				continue;
+			}
+			if(formater) {
+				formatted.push_back(formater(v->second));
+				size += formatted.back().size();
+			}
+			else {
+				size += v->second.size();
+			}
+		}
+		std::string out;
+		out.reserve(size);
+		size_t next_formatted = 0;
+		for(size_t i=0;i<segments_.size();i++) {
+			segment const &s = segments_[i];
+			if(!s.placeholder) {
+				out += s.text;
+				continue;
+			}
+			properties::properties_type::const_iterator v = values.find(s.text);
+			if(v == values.end()) {
+				out += s.raw;
+				continue;
+			}
+			std::string const &value = formater ? formatted[next_formatted++] : v->second;
+			append_unescaped(out,value.c_str(),value.c_str()+value.size());
 		}
-		return str_replace(fmtp, "%%", "%");
+		return out;
 	}
 
 	std::string connection_info::conn_str(std::string const &delimiter, std::string (*formater)(std::string const &)) const
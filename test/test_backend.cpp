@@ -19,6 +19,7 @@
 #include <cppdb/utils.h>
 #include <cppdb/ref_ptr.h>
 #include <cppdb/driver_manager.h>
+#include <cppdb/numeric_util.h>
 #include <sstream>
 #include <iostream>
 #include <stdexcept>
@@ -76,6 +77,101 @@ void test0(cppdb::ref_ptr<cppdb::backend::connection> /*sql*/, std::string const
 	std::string hay3 = "%19(aaa)abc %% %%123(aaa)x bla %%%-(aaa)p foo %+(aaa) bar (aaa)s xyz %%%%%%%(aaa)z $";
 	std::string result3 = "---bc %% %%123(aaa)x bla %%--- foo %+(aaa) bar (aaa)s xyz %%%%%%--- $";
 	TEST(result3 == cppdb::str_replace_format(hay3, "aaa", "---", 0));
+	TEST(cppdb::str_replace_format("%(a)s%(a)s%(b)s", "a", "x") == "xx%(b)s");
+	cppdb::properties props({{"a", "1"}, {"b", "%%2"}, {"table", "t"}});
+	TEST(props.format("%(a)s%(b)s %% %(c)s %-5(table)s") == "1%2 % %(c)s t");
+	TEST(props.format("%(a)s%(b)s %% %(c)s %-5(table)s") == "1%2 % %(c)s t");
+	cppdb::format_template tmpl("insert into %(table)s values(%(a)s)");
+	TEST(tmpl.placeholders() == 2);
+	TEST(tmpl.render(props) == "insert into t values(1)");
+
+	std::cout << "Test the connection string parsing" << std::endl;
+	cppdb::connection_info ci("sqlite3:db=test.db;@pool_size = 10 ;@bad=x1");
+	TEST(ci.driver == "sqlite3");
+	TEST(ci.get("db") == "test.db");
+	TEST(ci.get("@pool_size",0) == 10);
+	TEST(ci.get("@missing",5) == 5);
+	THROWS(ci.get("@bad",0),cppdb::cppdb_error);
+	TEST(ci.hash() == cppdb::connection_info::hash("sqlite3:db=test.db;@pool_size = 10 ;@bad=x1"));
+
+	std::cout << "Test the number formatting" << std::endl;
+	char buf[cppdb::number_buffer_size];
+	TEST(std::string(buf,cppdb::format_number(buf,0)) == "0");
+	TEST(std::string(buf,cppdb::format_number(buf,-1234)) == "-1234");
+	TEST(std::string(buf,cppdb::format_number(buf,std::numeric_limits<long long>::min())) == "-9223372036854775808");
+	TEST(std::string(buf,cppdb::format_number(buf,std::numeric_limits<unsigned long long>::max())) == "18446744073709551615");
+	TEST(std::string(buf,cppdb::format_number(buf,0.5)) == "0.5");
+	TEST(std::string(buf,cppdb::format_number(buf,-1e100)) == "-1e+100");
+
+	std::cout << "Test the number parsing" << std::endl;
+	std::string n;
+	n = "12345";
+	TEST(cppdb::parse_number<int>(n.c_str(),n.c_str()+n.size()) == 12345);
+	n = " -17 ";
+	TEST(cppdb::parse_number<long long>(n.c_str(),n.c_str()+n.size()) == -17);
+	n = "+17";
+	TEST(cppdb::parse_number<short>(n.c_str(),n.c_str()+n.size()) == 17);
+	n = "18446744073709551615";
+	TEST(cppdb::parse_number<unsigned long long>(n.c_str(),n.c_str()+n.size()) == std::numeric_limits<unsigned long long>::max());
+	THROWS(cppdb::parse_number<long long>(n.c_str(),n.c_str()+n.size()),cppdb::bad_value_cast);
+	n = "70000";
+	THROWS(cppdb::parse_number<short>(n.c_str(),n.c_str()+n.size()),cppdb::bad_value_cast);
+	n = "-1";
+	THROWS(cppdb::parse_number<unsigned>(n.c_str(),n.c_str()+n.size()),cppdb::bad_value_cast);
+	n = "-0";
+	TEST(cppdb::parse_number<unsigned>(n.c_str(),n.c_str()+n.size()) == 0);
+	n = "3.75";
+	TEST(cppdb::parse_number<int>(n.c_str(),n.c_str()+n.size()) == 3);
+	TEST(cppdb::parse_number<double>(n.c_str(),n.c_str()+n.size()) == 3.75);
+	n = "1e3";
+	TEST(cppdb::parse_number<int>(n.c_str(),n.c_str()+n.size()) == 1000);
+	n = "1e10";
+	THROWS(cppdb::parse_number<int>(n.c_str(),n.c_str()+n.size()),cppdb::bad_value_cast);
+	n = "12a";
+	THROWS(cppdb::parse_number<int>(n.c_str(),n.c_str()+n.size()),cppdb::bad_value_cast);
+	n = "";
+	THROWS(cppdb::parse_number<double>(n.c_str(),n.c_str()+n.size()),cppdb::bad_value_cast);
+	TEST(cppdb::numeric_cast<int>(-2147483648.0) == std::numeric_limits<int>::min());
+	TEST(cppdb::numeric_cast<int>(2147483647.5) == std::numeric_limits<int>::max());
+	THROWS(cppdb::numeric_cast<int>(2147483648.0),cppdb::bad_value_cast);
+	// max() of long long is rounded up to 2^63 in a double
+	THROWS(cppdb::numeric_cast<long long>(9223372036854775808.0),cppdb::bad_value_cast);
+	THROWS(cppdb::numeric_cast<unsigned long long>(18446744073709551616.0),cppdb::bad_value_cast);
+	THROWS(cppdb::numeric_cast<unsigned>(-1.0),cppdb::bad_value_cast);
+	THROWS(cppdb::numeric_cast<int>(std::numeric_limits<double>::quiet_NaN()),cppdb::bad_value_cast);
+
+	std::cout << "Test the date-time parsing and formatting" << std::endl;
+	std::tm t = cppdb::parse_datetime("2008-02-29T11:22:33.5+02:00");
+	TEST(t.tm_year == 2008 - 1900 && t.tm_mon == 1 && t.tm_mday == 29);
+	TEST(t.tm_hour == 11 && t.tm_min == 22 && t.tm_sec == 33);
+	TEST(t.tm_wday == 5 && t.tm_yday == 59);
+	TEST(cppdb::format_datetime(t) == "2008-02-29 11:22:33");
+	TEST(cppdb::format_date(cppdb::parse_date("2008-2-3")) == "2008-02-03");
+	TEST(cppdb::format_time(cppdb::parse_time("1:02:03")) == "01:02:03");
+	THROWS(cppdb::parse_datetime("2007-02-29 11:22:33"),cppdb::bad_value_cast);
+	THROWS(cppdb::parse_datetime("2008-02-03 24:00:00"),cppdb::bad_value_cast);
+	THROWS(cppdb::parse_datetime("2008-02-03 11:22:33 x"),cppdb::bad_value_cast);
+	THROWS(cppdb::parse_time("2008-02-03"),cppdb::bad_value_cast);
+	cppdb::sys_microseconds tp = cppdb::parse_timestamp("1970-01-01 00:00:01.25");
+	TEST(tp.time_since_epoch().count() == 1250000);
+	TEST(cppdb::parse_timestamp("1970-01-01T02:00:00+02") == cppdb::sys_microseconds());
+	TEST(cppdb::parse_timestamp("1969-12-31 23:59:59.999999Z").time_since_epoch().count() == -1);
+	TEST(cppdb::format_timestamp(cppdb::sys_microseconds(std::chrono::microseconds(-1))) == "1969-12-31 23:59:59.999999");
+	TEST(cppdb::format_timestamp(tp) == "1970-01-01 00:00:01.250000");
+	TEST(cppdb::format_timestamp(cppdb::parse_timestamp("2038-01-19 03:14:08")) == "2038-01-19 03:14:08");
+	THROWS(cppdb::parse_timestamp("11:22:33"),cppdb::bad_value_cast);
+	TEST(cppdb::make_timestamp(1970,1,1,0,0,1,250000) == tp);
+	TEST(cppdb::timestamp_to_tm(tp).tm_sec == 1);
+	cppdb::decimal d = cppdb::parse_decimal("-12345678901234567890.0100");
+	TEST(d.scale == 4);
+	TEST(cppdb::format_decimal(d) == "-12345678901234567890.0100");
+	TEST(cppdb::format_decimal(cppdb::parse_decimal("+.5")) == "0.5");
+	TEST(cppdb::format_decimal(cppdb::decimal(-5,2)) == "-0.05");
+	TEST(cppdb::parse_decimal("170141183460469231731687303715884105727") != cppdb::decimal());
+	TEST(cppdb::format_decimal(cppdb::parse_decimal("-170141183460469231731687303715884105728")) == "-170141183460469231731687303715884105728");
+	THROWS(cppdb::parse_decimal("170141183460469231731687303715884105728"),cppdb::bad_value_cast);
+	THROWS(cppdb::parse_decimal("1.2.3"),cppdb::bad_value_cast);
+	THROWS(cppdb::parse_decimal("-"),cppdb::bad_value_cast);
 }
 
 void test05(cppdb::ref_ptr<cppdb::backend::connection> /*sql*/, std::string const &/*cs*/)
@@ -144,6 +240,7 @@ void test1(cppdb::ref_ptr<cppdb::backend::connection> sql, std::string const &/*
 	stmt->exec();
 	stmt = sql->prepare("select * from test");
 	res = stmt->query();
+	TEST(res->has_next() != cppdb::backend::result::next_row_exists);
 	TEST(!res->next());
 	stmt  = sql->prepare("insert into test(x,y) values(10,'foo?')");
 	stmt->exec();
@@ -159,6 +256,23 @@ void test1(cppdb::ref_ptr<cppdb::backend::connection> sql, std::string const &/*
 	TEST(res->fetch(1,sv));
 	TEST(sv=="foo?");
 	TEST(!res->next());
+	if(sql->driver()=="mysql" || sql->driver()=="odbc")
+		TEST(!res->next_result());
+	else
+		THROWS(res->next_result(),cppdb::not_supported_by_backend);
+	res.reset();
+	stmt->reset();
+	if(stmt->start_async()) {
+		while(!stmt->poll_async())
+			;
+	}
+	TEST(stmt->poll_async());
+	TEST(sql->poll_async());
+	res = stmt->query();
+	TEST(res->next());
+	TEST(res->fetch(0,iv));
+	TEST(iv==10);
+	TEST(!res->next());
 	res.reset();
 	stmt = sql->prepare("insert into test(x,y) values(20,NULL)");
 	stmt->exec();
@@ -247,6 +361,38 @@ void test2(cppdb::ref_ptr<cppdb::backend::connection> sql, std::string const &/*
 		stmt->bind(1,20);
 		stmt->exec();
 		TEST(stmt->sequence_last("test_id_seq") == 2);
+		long long id = 0;
+		stmt->reset();
+		stmt->bind(1,30);
+		res = stmt->exec_returning({"id"});
+		TEST(res->next());
+		TEST(res->fetch(0,id) && id == 3);
+		TEST(!res->next());
+		res.reset();
+		// the values stay bound to the statement
+		stmt->exec();
+		TEST(stmt->sequence_last("test_id_seq") == 4);
+		stmt = sql->prepare("select count(*) from test where n=30");
+		res = stmt->query();
+		TEST(res->next());
+		TEST(res->fetch(0,id) && id == 2);
+		res.reset();
+		stmt = sql->prepare("insert into test(n) values(?),(?)");
+		stmt->bind(1,40);
+		stmt->bind(2,50);
+		if(sql->engine() == "mysql") {
+			// only the first id of a multiple row insert is reported
+			THROWS(stmt->exec_returning({"id"}),cppdb::not_supported_by_backend);
+		}
+		else {
+			res = stmt->exec_returning({"id"});
+			TEST(res->next());
+			TEST(res->fetch(0,id) && id == 5);
+			TEST(res->next());
+			TEST(res->fetch(0,id) && id == 6);
+			TEST(!res->next());
+			res.reset();
+		}
 		stmt = sql->prepare("drop table test");
 		stmt->exec();
 		stmt.reset();
@@ -365,6 +511,11 @@ void test3(cppdb::ref_ptr<cppdb::backend::connection> sql, std::string const &/*
 		if(test_blob)
 			TEST(res->name_to_column("bl")==4);
 		TEST(res->name_to_column("x")==-1);
+		if(sql->engine()=="sqlite3") {
+			TEST(!res->declared_type(0).empty());
+			TEST(res->declared_type(3)=="varchar(5000)");
+			TEST(res->has_next() == cppdb::backend::result::next_row_exists);
+		}
 		
 		TEST(res->next());
 
@@ -792,6 +943,82 @@ void test9(cppdb::ref_ptr<cppdb::backend::connection> sql, std::string const &/*
 		TEST(t.tm_min == 22);
 		TEST(t.tm_sec == 33);
 	}
+	{
+		stmt=sql->prepare("delete from test");
+		stmt->exec();
+		std::cout << "- microsecond time point" << std::endl;
+		bool has_fraction = sql->engine()=="sqlite3" || sql->engine()=="postgresql";
+		cppdb::sys_microseconds tp = cppdb::parse_timestamp(has_fraction ? "2008-02-03 11:22:33.456789" : "2008-02-03 11:22:33");
+		stmt=sql->prepare("insert into test(t) values(?)");
+		stmt->bind(1,tp);
+		stmt->exec();
+		stmt=sql->prepare("select t from test");
+		res = stmt->query();
+		res->next();
+		cppdb::sys_microseconds v;
+		TEST(res->fetch(0,v));
+		TEST(v == tp);
+	}
+	if(sql->engine()=="postgresql") {
+		std::cout << "- time point to timestamptz" << std::endl;
+		sql->prepare("create temporary table tz_test ( t timestamptz )")->exec();
+		sql->prepare("set time zone 'America/New_York'")->exec();
+		cppdb::sys_microseconds tp = cppdb::parse_timestamp("2008-02-03 11:22:33.456789");
+		// text parameters of a prepared statement and binary parameters of an unprepared one
+		stmt=sql->get_prepared_statement("insert into tz_test(t) values(?)");
+		stmt->bind(1,tp);
+		stmt->exec();
+		stmt=sql->get_statement("insert into tz_test(t) values(?)");
+		stmt->bind(1,tp);
+		stmt->exec();
+		stmt=sql->prepare("select t, t at time zone 'UTC' from tz_test");
+		res = stmt->query();
+		for(int i=0;i<2;i++) {
+			TEST(res->next());
+			cppdb::sys_microseconds v;
+			TEST(res->fetch(0,v));
+			TEST(v == tp);
+			std::string s;
+			TEST(res->fetch(1,s));
+			TEST(s == "2008-02-03 11:22:33.456789");
+		}
+		res.reset();
+		stmt.reset();
+		sql->prepare("reset time zone")->exec();
+		sql->prepare("drop table tz_test")->exec();
+	}
+	{
+		stmt=sql->prepare("delete from test");
+		stmt->exec();
+		std::cout << "- microseconds since the epoch" << std::endl;
+		stmt=sql->prepare("insert into test(i) values(?)");
+		stmt->bind(1,1202037753456789LL);
+		stmt->exec();
+		stmt=sql->prepare("select i from test");
+		res = stmt->query();
+		res->next();
+		cppdb::sys_microseconds v;
+		TEST(res->fetch(0,v));
+		TEST(v == cppdb::make_timestamp(2008,2,3,11,22,33,456789));
+	}
+	{
+		stmt=sql->prepare("delete from test");
+		stmt->exec();
+		std::cout << "- decimal" << std::endl;
+		stmt=sql->prepare("insert into test(i,s) values(?,?)");
+		stmt->bind(1,cppdb::decimal(-1234567890123LL));
+		stmt->bind(2,cppdb::parse_decimal("-12345678901234567890123.4500"));
+		stmt->exec();
+		stmt=sql->prepare("select i,s from test");
+		res = stmt->query();
+		res->next();
+		cppdb::decimal v;
+		TEST(res->fetch(0,v));
+		TEST(v == cppdb::decimal(-1234567890123LL));
+		TEST(res->fetch(1,v));
+		TEST(cppdb::format_decimal(v) == "-12345678901234567890123.4500");
+		TEST(v.scale == 4);
+	}
 
 }
 
@@ -815,6 +1042,23 @@ void test10(cppdb::ref_ptr<cppdb::backend::connection> sql, std::string const &c
 	else {
 		TEST(conn_dialect.get() == test_dialect.get());
 	}
+
+	std::cout << "- insert returning" << std::endl;
+	std::vector<std::string> cols = {"id", "n"};
+	typedef std::vector<std::pair<std::string, std::string> > keywords;
+	cppdb::ref_ptr<cppdb::backend::dialect> returning(new cppdb::backend::dialect(keywords{{"insert_returning", "returning"}}));
+	TEST(returning->insert_returning("insert into t(n) values(?);", cols) == "insert into t(n) values(?) RETURNING id, n");
+	cppdb::ref_ptr<cppdb::backend::dialect> output(new cppdb::backend::dialect(keywords{{"insert_returning", "output"}}));
+	TEST(output->insert_returning("insert into t(n, \"values\") Values(?, 'select')", cols)
+		== "insert into t(n, \"values\") OUTPUT INSERTED.id, INSERTED.n Values(?, 'select')");
+	TEST(output->insert_returning("insert into t default values", {"id"}) == "insert into t OUTPUT INSERTED.id default values");
+	TEST(output->insert_returning("insert into select_values(n) select n from t", {"id"})
+		== "insert into select_values(n) OUTPUT INSERTED.id select n from t");
+	cppdb::ref_ptr<cppdb::backend::dialect> generic(new cppdb::backend::dialect());
+	TEST(generic->insert_returning("insert into t(n) values(?)", cols).empty());
+	TEST(cppdb::backend::dialect::rewrite_returning("output", "insert into t(n) values(?)", {"id"})
+		== "insert into t(n) OUTPUT INSERTED.id values(?)");
+	TEST(cppdb::backend::dialect::rewrite_returning("none", "insert into t(n) values(?)", cols).empty());
 }
 
 
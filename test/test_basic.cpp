@@ -17,6 +17,8 @@
 ///////////////////////////////////////////////////////////////////////////////
 #include <cppdb/frontend.h>
 #include <cppdb/connection_specific.h>
+#include <cppdb/mapper.h>
+#include <cppdb/backend.h>
 #include <iostream>
 #include <sstream>
 
@@ -24,6 +26,7 @@
 #include <cppdb/utils.h>
 #include <cppdb/driver_manager.h>
 #include <cppdb/conn_manager.h>
+#include <cppdb/sqlite3_backend.h>
 
 
 #define TEST(x) do { if(x) break; std::ostringstream ss; ss<<"Failed in " << __LINE__ <<' '<< #x; throw std::runtime_error(ss.str()); } while(0)
@@ -54,6 +57,157 @@ struct functor_caller {
 	}
 };
 
+struct sum_squares {
+	long long total;
+	sum_squares() : total(0) {}
+	void step(int v) { total += v * v; }
+	void inverse(int v) { total -= v * v; }
+	long long result() { return total; }
+};
+
+long long twice(long long v)
+{
+	return v * 2;
+}
+
+void test_sqlite3_functions(cppdb::session &sql)
+{
+	std::cout << "Testing sqlite3 user defined functions" << std::endl;
+	TEST(sql.get_extension<cppdb::sqlite3_backend::extension>()!=0);
+	cppdb::sqlite3_backend::create_function(sql,"twice",&twice);
+	cppdb::sqlite3_backend::create_function(sql,"greet",[](std::string const &n) { return "Hello " + n; });
+	cppdb::sqlite3_backend::create_aggregate<sum_squares>(sql,"sum_squares");
+	long long v = 0;
+	sql << "SELECT twice(?)" << 21 << cppdb::row >> v;
+	TEST(v == 42);
+	cppdb::result r = sql << "SELECT twice(NULL)" << cppdb::row;
+	TEST(r.is_null(0));
+	std::string s;
+	sql << "SELECT greet('World')" << cppdb::row >> s;
+	TEST(s == "Hello World");
+	sql << "SELECT sum_squares(x) FROM (SELECT 1 AS x UNION ALL SELECT 2 UNION ALL SELECT NULL UNION ALL SELECT 3)"
+		<< cppdb::row >> v;
+	TEST(v == 14);
+	sql << "SELECT sum_squares(x) FROM (SELECT 1 AS x) WHERE x > 1" << cppdb::row >> v;
+	TEST(v == 0);
+	bool window_supported = true;
+	try {
+		cppdb::sqlite3_backend::create_window_function<sum_squares>(sql,"win_squares");
+	}
+	catch(cppdb::not_supported_by_backend const &) {
+		window_supported = false;
+	}
+	if(window_supported) {
+		r = sql <<	"SELECT win_squares(x) OVER (ORDER BY x ROWS BETWEEN 1 PRECEDING AND CURRENT ROW) "
+				"FROM (SELECT 1 AS x UNION ALL SELECT 2 UNION ALL SELECT 3) ORDER BY x";
+		long long expected[3] = { 1, 5, 13 };
+		for(int i=0;i<3;i++) {
+			TEST(r.next());
+			r >> v;
+			TEST(v == expected[i]);
+		}
+		TEST(!r.next());
+	}
+	sql << "SELECT twice(CAST(? AS INTEGER))" << "5" << cppdb::row >> v;
+	TEST(v == 10);
+	sql.get_extension<cppdb::sqlite3_backend::extension>()->remove_function("twice",1);
+	bool thrown = false;
+	try {
+		sql << "SELECT twice(1)" << cppdb::row;
+	}
+	catch(cppdb::cppdb_error const &) {
+		thrown = true;
+	}
+	TEST(thrown);
+}
+
+void test_sqlite3_backup(cppdb::session &sql)
+{
+	std::cout << "Testing sqlite3 online backup" << std::endl;
+	sql << "INSERT INTO test(n,name) VALUES(?,?)" << 42 << "backup" << cppdb::exec;
+	cppdb::session copy = cppdb::sqlite3_backend::clone_to_memory(sql);
+	int n = 0;
+	copy << "SELECT count(*) FROM test" << cppdb::row >> n;
+	TEST(n == 1);
+	copy << "SELECT n FROM test" << cppdb::row >> n;
+	TEST(n == 42);
+
+	int steps = 0;
+	int last_remaining = -1;
+	cppdb::session target("sqlite3:db=:memory:");
+	cppdb::sqlite3_backend::backup(sql,target,[&](int remaining,int total) {
+		steps++;
+		last_remaining = remaining;
+		return remaining <= total;
+	},1);
+	TEST(steps > 1);
+	TEST(last_remaining == 0);
+	target << "SELECT count(*) FROM test" << cppdb::row >> n;
+	TEST(n == 1);
+
+	bool thrown = false;
+	try {
+		cppdb::session aborted("sqlite3:db=:memory:");
+		cppdb::sqlite3_backend::backup(sql,aborted,[](int,int) { return false; },1);
+	}
+	catch(cppdb::cppdb_error const &) {
+		thrown = true;
+	}
+	TEST(thrown);
+	sql << "DELETE FROM test" << cppdb::exec;
+}
+
+struct person {
+	int id;
+	std::string name;
+	double score;
+};
+
+namespace cppdb {
+namespace schema {
+	template<>
+	struct mapping<person> {
+		static constexpr auto fields()
+		{
+			return std::make_tuple(
+				make_field("id", &person::id),
+				make_field("name", &person::name),
+				make_field("score", &person::score));
+		}
+	};
+} // schema
+} // cppdb
+
+void test_mapper(cppdb::session &sql)
+{
+	std::cout << "Testing entity mapper" << std::endl;
+	try {
+		sql << "DROP TABLE mapped_person" << cppdb::exec;
+	}
+	catch(cppdb::cppdb_error const &e){}
+	sql << "create table mapped_person ( id integer primary key autoincrement not null, name text, score real)" << cppdb::exec;
+	cppdb::schema::mapper<person> m("mapped_person", {"id"}, {"id"});
+	TEST(m.sql().insert_sql() == "INSERT INTO mapped_person(name, score) VALUES(?, ?)");
+	TEST(m.sql().update_sql() == "UPDATE mapped_person SET name = ?, score = ? WHERE id = ?");
+	TEST(m.sql().select_sql() == "SELECT id, name, score FROM mapped_person WHERE id = ?");
+	TEST(m.sql().delete_sql() == "DELETE FROM mapped_person WHERE id = ?");
+
+	person a = { 0, "Anna", 1.5 }, b = { 0, "Ben", 2.5 };
+	m.insert(sql, a);
+	m.insert(sql, b);
+	TEST(a.id == 1 && b.id == 2);
+	person c = { 2, "", 0 };
+	TEST(m.load(sql, c));
+	TEST(c.name == "Ben" && c.score == 2.5);
+	c.name = "Bob";
+	m.update(sql, c);
+	person d = { 2, "", 0 };
+	TEST(m.load(sql, d) && d.name == "Bob");
+	m.remove(sql, d);
+	TEST(!m.load(sql, d));
+	TEST(m.load(sql, a) && a.name == "Anna");
+	sql << "DROP TABLE mapped_person" << cppdb::exec;
+}
 
 int main(int argc,char **argv)
 {
@@ -152,6 +306,77 @@ int main(int argc,char **argv)
 		TEST(val == 10);
 		res.clear();
 
+		{
+			std::cout << "Testing connection arena" << std::endl;
+			cppdb::ref_ptr<cppdb::backend::arena> memory(new cppdb::backend::arena());
+			std::pmr::memory_resource *r = memory->resource();
+			void *first = r->allocate(256,alignof(std::max_align_t));
+			r->deallocate(first,256,alignof(std::max_align_t));
+			void *second = r->allocate(256,alignof(std::max_align_t));
+			TEST(first == second);
+			r->deallocate(second,256,alignof(std::max_align_t));
+			for(int i=0;i<100;i++) {
+				res = sql << "SELECT n FROM test WHERE id=?" << 1 << cppdb::row;
+				TEST(!res.empty());
+				res >> val;
+				TEST(val == 10);
+			}
+			res.clear();
+		}
+
+		{
+			std::cout << "Testing asynchronous execution" << std::endl;
+			cppdb::statement st = sql << "SELECT n FROM test WHERE id=?" << 2;
+			std::future<cppdb::result> fr = st.async_query();
+			while(!st.ready() || !sql.poll())
+				;
+			res = fr.get();
+			TEST(res.next());
+			res >> val;
+			TEST(val == 10);
+			TEST(!res.next());
+			res.clear();
+			cppdb::statement started = sql << "SELECT n FROM test WHERE id=?" << 1;
+			if(started.start()) {
+				// other statements wait for the started query and do not discard its rows
+				st = sql << "SELECT n FROM test WHERE id=?" << 2;
+				res = st.query();
+				TEST(res.next());
+				res >> val;
+				TEST(val == 10);
+				res.clear();
+				// the same as async_query() does for a started statement
+				std::future<cppdb::result> fs = std::async(std::launch::deferred,[&started]() { return started.query(); });
+				res = fs.get();
+				TEST(res.next());
+				res >> val;
+				TEST(val == 10);
+				TEST(!res.next());
+				res.clear();
+			}
+			started.clear();
+			st = sql << "UPDATE test SET n=? WHERE id=?" << 11 << 2;
+			st.async_exec().get();
+			TEST(st.affected()==1);
+			// the statement is released by the task before get() returns, so the session
+			// can be used right away
+			sql.prepare("UPDATE test SET n=? WHERE id=?").bind(10).bind(2).async_exec().get();
+			res = sql << "SELECT n FROM test WHERE id=?" << 2 << cppdb::row;
+			TEST(!res.empty());
+			res >> val;
+			TEST(val == 10);
+			res.clear();
+			st = sql << "INSERT INTO test(id,n) VALUES(?,?)" << 1 << 10;
+			bool thrown = false;
+			try {
+				st.async_exec().get();
+			}
+			catch(cppdb::cppdb_error const &) {
+				thrown = true;
+			}
+			TEST(thrown);
+		}
+
 		cppdb::statement stat = sql<<"delete from test where 1<>0" << cppdb::exec;
 		std::cout<<"Deleted "<<stat.affected()<<" rows\n";
 		TEST(stat.affected()==2);
@@ -177,6 +402,14 @@ int main(int argc,char **argv)
 		TEST(sql.get_specific<my_specific_a>()==0);
 		TEST(sql.release_specific<my_specific_a>() == 0);
 		
+		if(sql.driver() == "sqlite3") {
+			test_sqlite3_functions(sql);
+			test_sqlite3_backup(sql);
+			test_mapper(sql);
+		}
+		else
+			TEST(sql.get_extension<cppdb::sqlite3_backend::extension>()==0);
+		
 		TEST(call_counter == 0);
 		TEST(sql.once_called()==false);
 		sql.once(&caller);
@@ -64,6 +64,12 @@ void test_driver_manager()
 	THROWS(c1=dm.connect("dummy:"),cppdb::cppdb_error);
 	std::cout << "Testing connection pooling" << std::endl;
 	dm.install_driver("dummy",new dummy::loadable_driver());
+	c1=cm.open("dummy:");
+	c2=cm.open("dummy:");
+	TEST(dummy::connections==2);
+	c1.reset();
+	c2.reset();
+	TEST(dummy::connections==0);
 	c1=cm.open("dummy:@pool_size=2;@pool_max_idle=2");
 	TEST(dummy::connections==1);
 	c2=cm.open("dummy:@pool_size=2;@pool_max_idle=2");
@@ -155,6 +161,29 @@ void test_stmt_cache()
 	c.reset();
 	TEST(dummy::connections==0);
 
+	c=dm.connect("dummy:@use_prepared=on;@stmt_cache_size=2");
+	s1=c->prepare("test1");
+	s1=c->prepare("test2");
+	s1.reset();
+	TEST(dummy::statements==2);
+	// test2 is in use, it is neither counted nor evicted
+	s1=c->prepare("test2");
+	s2=c->prepare("test3");
+	s2.reset();
+	TEST(dummy::statements==3);
+	s2=c->prepare("test1");
+	TEST(dummy::statements==3);
+	s2.reset();
+	s1.reset();
+	TEST(dummy::statements==2);
+	s1=c->prepare("test2");
+	TEST(dummy::statements==2);
+	s1.reset();
+
+	c->clear_cache();
+	c.reset();
+	TEST(dummy::connections==0);
+
 	c=dm.connect("dummy:@use_prepared=on;@stmt_cache_size=0");
 	TEST(dummy::connections==1);
 	s1=c->prepare("test1");
@@ -19,8 +19,30 @@
 #include <cppdb/driver_manager.h>
 #include <cppdb/conn_manager.h>
 #include <iostream>
+#include <atomic>
+#include <new>
 #include <stdlib.h>
 
+// counts the heap allocations, so the steady state loops can be checked to be allocation free
+static std::atomic<long> allocations(0);
+
+void *operator new(size_t n)
+{
+	allocations.fetch_add(1,std::memory_order_relaxed);
+	void *p = malloc(n ? n : 1);
+	if(!p)
+		throw std::bad_alloc();
+	return p;
+}
+void operator delete(void *p) noexcept
+{
+	free(p);
+}
+void operator delete(void *p,size_t) noexcept
+{
+	free(p);
+}
+
 #if defined WIN32  || defined _WIN32 || defined __WIN32 || defined(__CYGWIN__)
 
 #ifndef NOMINMAX
@@ -80,6 +102,26 @@ private:
 
 #endif
 
+template<typename Object>
+double copy_ref_ptr(int n)
+{
+	timer tm;
+	cppdb::ref_ptr<Object> obj(new Object());
+	long sum = 0;
+	tm.start();
+	for(int i=0;i<n;i++) {
+		cppdb::ref_ptr<Object> copy(obj);
+		sum += copy->use_count();
+	}
+	tm.stop();
+	if(sum != 2L * n)
+		throw std::runtime_error("Wrong reference count");
+	return tm.diff();
+}
+
+struct shared_object : public cppdb::ref_counted {};
+struct local_object : public cppdb::local_ref_counted {};
+
 int main(int argc,char **argv)
 {
 	if(argc!=2) {
@@ -87,6 +129,10 @@ int main(int argc,char **argv)
 		return 1;
 	}
 	try {
+		static const int ref_copies = 10000000;
+		std::cout << "copied atomic ref_ptr " << ref_copies << " times in " << copy_ref_ptr<shared_object>(ref_copies) << " seconds" << std::endl;
+		std::cout << "copied local ref_ptr " << ref_copies << " times in " << copy_ref_ptr<local_object>(ref_copies) << " seconds" << std::endl;
+
 		static const int max_val = 10000;
 		cppdb::session sql(argv[1]);
 
@@ -132,14 +178,22 @@ int main(int argc,char **argv)
 		tm.start();
 		std::string select(SELECT);
 		std::string hello(HELLO);
+		long allocated = 0;
 		for(int j=0;j<max_val * 10;j++) {
+			// the first iteration prepares the statement and fills the caches
+			if(j==1)
+				allocated = allocations.load();
 			std::string v;
 			sql << select << (rand() % max_val)<< cppdb::row >> v;
 			if(v!=hello)
 				throw std::runtime_error("Wrong");
 		}
+		allocated = allocations.load() - allocated;
 		tm.stop();
-		std::cout << "searched by index " << 10 * max_val << " times in " << tm.diff() << " seconds" << std::endl;
+		std::cout << "searched by index " << 10 * max_val << " times in " << tm.diff() << " seconds, "
+			<< allocated << " allocations" << std::endl;
+		if(allocated != 0)
+			throw std::runtime_error("Cached statements should not allocate memory");
 		sql.clear_cache();
 #endif
 